@@ -41,6 +41,8 @@ namespace WinMLRunnerTest
     static const std::wstring EXE_PATH = CURRENT_PATH + L"WinMLRunner.exe";
     static const std::wstring INPUT_FOLDER_PATH = CURRENT_PATH + L"test_folder_input";
     static const std::wstring OUTPUT_PATH = CURRENT_PATH + L"test_output.csv";
+    // Where scaling curves go when -PerfOutput is OUTPUT_PATH
+    static const std::wstring SCALING_OUTPUT_PATH = CURRENT_PATH + L"test_output_scaling.csv";
     static const std::wstring TENSOR_DATA_PATH = CURRENT_PATH + L"TestResults";
 
     static std::wstring BuildCommand(std::initializer_list<std::wstring>&& arguments)
@@ -298,6 +300,139 @@ namespace WinMLRunnerTest
             // We need to expect one more line because of the header
             Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
         }
+        TEST_METHOD(GarbageInputOnlyCpuPipelined)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH,
+                                                        L"-perf", L"-CPU", L"-Iterations", L"10", L"-Pipeline", L"3" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuAsyncDepth)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH,
+                                                        L"-perf", L"-CPU", L"-Iterations", L"10", L"-AsyncDepth", L"4" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuOpenLoop)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Iterations", L"20", L"-OpenLoop", L"50", L"Poisson", L"-NumThreads", L"2" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuOpenLoopMaxQueueDepth)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Iterations", L"20", L"-OpenLoop", L"200", L"-NumThreads", L"1", L"-MaxQueueDepth",
+                               L"2", L"DropOldest" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuOpenLoopMaxThreads)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Iterations", L"20", L"-OpenLoop", L"200", L"-NumThreads", L"1", L"-MaxThreads",
+                               L"4" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuOpenLoopThreadPoolStats)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Iterations", L"20", L"-OpenLoop", L"200", L"-NumThreads", L"2",
+                               L"-ThreadPoolStats" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuPerfTimingOnly)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Iterations", L"20", L"-PerfTimingOnly" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuBatchSize)
+        {
+            // The batch dimension of candy.onnx is free, so every batch size of the sweep gets its own session
+            const std::wstring modelPath = CURRENT_PATH + L"candy.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-Tensor", L"-BatchSize", L"1,2" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // One line per batch size and one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(3), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuAdaptiveIterations)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-AdaptiveIterations", L"Median", L"-Iterations", L"100" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuRecreateSession)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-RGB", L"-Tensor", L"-RecreateSession", L"-SessionCreationIterations", L"2" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(3), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuSessionCreationIterations)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH, L"-perf", L"-CPU",
+                               L"-RGB", L"-Tensor", L"-SessionCreationIterations", L"2" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(3), GetOutputCSVLineCount());
+        }
+        TEST_METHOD(GarbageInputOnlyCpuBindOutputs)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-model", modelPath, L"-PerfOutput", OUTPUT_PATH,
+                                                        L"-perf", L"-CPU", L"-Tensor", L"-BindOutputs" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // Unbound and bound outputs are reported on separate lines, plus one line for the header
+            Assert::AreEqual(static_cast<size_t>(3), GetOutputCSVLineCount());
+        }
         TEST_METHOD(GarbageInputCpuWinMLDeviceCpuBoundRGBImage)
         {
             const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
@@ -517,6 +652,17 @@ namespace WinMLRunnerTest
             // We need to expect one more line because of the header
             Assert::AreEqual(static_cast<size_t>(5), GetOutputCSVLineCount());
         }
+
+        TEST_METHOD(RunAllModelsInFolderGarbageInputPrefetched)
+        {
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-folder", INPUT_FOLDER_PATH, L"-PerfOutput", OUTPUT_PATH, L"-perf",
+                               L"-PrefetchModels", L"2", L"-PrefetchSessions" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(5), GetOutputCSVLineCount());
+        }
     };
 
     TEST_CLASS(ImageInputTest)
@@ -548,6 +694,15 @@ namespace WinMLRunnerTest
             Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
         }
 
+        TEST_METHOD(ProvidedImageInputOnlyCpuCacheInputFeatures)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring inputPath = CURRENT_PATH + L"fish.png";
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-model ", modelPath, L"-input", inputPath, L"-CPU",
+                                                        L"-Iterations", L"5", L"-CacheInputFeatures" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+        }
+
         TEST_METHOD(ProvidedImageInputOnlyGpu)
         {
             const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
@@ -857,6 +1012,78 @@ namespace WinMLRunnerTest
             });
             Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
         }
+
+        TEST_METHOD(ConcurrentLoadScaling)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-CPU", L"-ConcurrentLoad", L"-NumThreads", L"2",
+                               L"-PerfOutput", OUTPUT_PATH });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // Loading with 1 and 2 threads, evaluating with a shared session and a shared model with 1 and 2 threads,
+            // and one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(7), GetOutputCSVLineCount(SCALING_OUTPUT_PATH));
+            std::remove(std::string(SCALING_OUTPUT_PATH.begin(), SCALING_OUTPUT_PATH.end()).c_str());
+        }
+
+        TEST_METHOD(ThreadPoolBenchmark)
+        {
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-ThreadPoolBenchmark", L"10000", L"-NumThreads",
+                                                        L"2", L"-PerfOutput", OUTPUT_PATH });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // Five thread pool variants with 1 and 2 workers, and one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(11), GetOutputCSVLineCount(SCALING_OUTPUT_PATH));
+            std::remove(std::string(SCALING_OUTPUT_PATH.begin(), SCALING_OUTPUT_PATH.end()).c_str());
+        }
+
+        TEST_METHOD(ThreadPoolBenchmarkSpread)
+        {
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-ThreadPoolBenchmark", L"10000", L"-NumThreads", L"2", L"-ThreadPlacement",
+                               L"Spread", L"-PerfOutput", OUTPUT_PATH });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // Five thread pool variants with 1 and 2 workers, and one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(11), GetOutputCSVLineCount(SCALING_OUTPUT_PATH));
+            std::remove(std::string(SCALING_OUTPUT_PATH.begin(), SCALING_OUTPUT_PATH.end()).c_str());
+        }
+
+        TEST_METHOD(Throughput)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command = BuildCommand({ EXE_PATH, L"-model", modelPath, L"-CPU", L"-Iterations", L"5",
+                                                        L"-Throughput", L"2x2", L"-PerfOutput", OUTPUT_PATH, L"-perf" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // We need to expect one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(2), GetOutputCSVLineCount());
+            std::remove(std::string(OUTPUT_PATH.begin(), OUTPUT_PATH.end()).c_str());
+        }
+
+        TEST_METHOD(SweepWorkers)
+        {
+            const std::wstring modelPath = CURRENT_PATH + L"SqueezeNet.onnx";
+            const std::wstring command =
+                BuildCommand({ EXE_PATH, L"-model", modelPath, L"-CPU", L"-GPU", L"-SweepWorkers", L"2",
+                               L"-JobTimeout", L"600", L"-PerfOutput", OUTPUT_PATH, L"-perf" });
+            Assert::AreEqual(S_OK, RunProc(const_cast<wchar_t*>(command.c_str())));
+
+            // One line per job and one more line because of the header
+            Assert::AreEqual(static_cast<size_t>(3), GetOutputCSVLineCount());
+            std::remove(std::string(OUTPUT_PATH.begin(), OUTPUT_PATH.end()).c_str());
+            std::filesystem::path sweepDirectory(OUTPUT_PATH);
+            sweepDirectory.replace_extension();
+            sweepDirectory += L"_sweep";
+            try
+            {
+                std::filesystem::remove_all(sweepDirectory);
+            }
+            catch (const std::filesystem::filesystem_error&)
+            {
+            }
+        }
     };
 
     TEST_CLASS(OtherTests)
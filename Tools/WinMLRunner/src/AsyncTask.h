@@ -0,0 +1,472 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "ThreadPool.h"
+
+// Same choice of coroutine support as C++/WinRT, so AsyncTask coroutines can co_await WinRT async operations: the
+// standard header when the compiler has it, the coroutines TS enabled by /await otherwise.
+#if __has_include(<version>)
+#include <version>
+#endif
+#ifdef __cpp_lib_coroutine
+#include <coroutine>
+template <typename Promise = void>
+using CoroutineHandle = std::coroutine_handle<Promise>;
+using SuspendAlways = std::suspend_always;
+#else
+#include <experimental/coroutine>
+template <typename Promise = void>
+using CoroutineHandle = std::experimental::coroutine_handle<Promise>;
+using SuspendAlways = std::experimental::suspend_always;
+#endif
+
+// Run when an AsyncTask completes, to resume a coroutine awaiting it or to count down a WhenAll or WhenAny
+struct AsyncContinuation
+{
+    void (*Run)(void* context);
+    void* Context;
+};
+
+// Lets stages check whether the work they belong to is still wanted. Tokens are cheap to copy and all tokens of a
+// CancellationSource see its Cancel().
+class CancellationToken
+{
+public:
+    // A token that is never cancelled
+    CancellationToken() = default;
+
+    bool IsCancelled() const { return m_isCancelled && *m_isCancelled; }
+    void ThrowIfCancelled() const
+    {
+        if (IsCancelled())
+        {
+            throw TaskCancelled();
+        }
+    }
+
+private:
+    friend class CancellationSource;
+    explicit CancellationToken(std::shared_ptr<std::atomic<bool>> isCancelled) : m_isCancelled(isCancelled) {}
+
+    std::shared_ptr<std::atomic<bool>> m_isCancelled;
+};
+
+class CancellationSource
+{
+public:
+    CancellationSource() : m_isCancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel() { *m_isCancelled = true; }
+    bool IsCancelled() const { return *m_isCancelled; }
+    CancellationToken Token() const { return CancellationToken(m_isCancelled); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_isCancelled;
+};
+
+// State shared by the promises of all AsyncTask types. The coroutine starts when it is first awaited, started or
+// waited for and runs on the starting thread until it suspends, typically by awaiting ResumeOn or a WinRT async
+// operation.
+class AsyncTaskPromiseBase
+{
+public:
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        void await_suspend(CoroutineHandle<Promise> handle) noexcept
+        {
+            handle.promise().Complete();
+        }
+        void await_resume() noexcept {}
+    };
+
+    SuspendAlways initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { m_error = std::current_exception(); }
+
+    // Starts the coroutine if it hasn't started yet and runs continuation once the coroutine has completed. Returns
+    // false without running continuation if the coroutine has completed before Start returns, so that a coroutine
+    // awaiting one that completes synchronously continues on its own stack instead of nesting.
+    bool Start(CoroutineHandle<> handle, AsyncContinuation continuation)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_isCompleted)
+        {
+            return false;
+        }
+        if (!m_isStarted)
+        {
+            m_isStarted = true;
+            m_isStarting = true;
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            m_isStarting = false;
+            // Waiters don't destroy the coroutine while it is starting
+            m_completed.notify_all();
+            if (m_isCompleted)
+            {
+                return false;
+            }
+        }
+        m_continuations.push_back(continuation);
+        return true;
+    }
+
+    // Starts the coroutine if it hasn't started yet and blocks until it has completed
+    void Wait(CoroutineHandle<> handle)
+    {
+        Start(handle, { [](void*) {}, nullptr });
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_completed.wait(lock, [this] { return m_isCompleted && !m_isStarting; });
+    }
+
+    bool IsStarted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_isStarted;
+    }
+
+    bool IsCompleted()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_isCompleted;
+    }
+
+protected:
+    void RethrowError()
+    {
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+private:
+    void Complete()
+    {
+        std::vector<AsyncContinuation> continuations;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isCompleted = true;
+            continuations.swap(m_continuations);
+            // Notified with the lock held because the waiter destroys the coroutine as soon as it wakes up
+            m_completed.notify_all();
+        }
+        // The coroutine may already be destroyed here, so only the local copy is used
+        for (const AsyncContinuation& continuation : continuations)
+        {
+            continuation.Run(continuation.Context);
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_completed;
+    bool m_isStarted = false;
+    // Set while Start() is resuming the coroutine for the first time
+    bool m_isStarting = false;
+    bool m_isCompleted = false;
+    std::vector<AsyncContinuation> m_continuations;
+    std::exception_ptr m_error;
+};
+
+template <typename T>
+class AsyncTask;
+
+template <typename T>
+class AsyncTaskPromise : public AsyncTaskPromiseBase
+{
+public:
+    AsyncTask<T> get_return_object() { return AsyncTask<T>(CoroutineHandle<AsyncTaskPromise>::from_promise(*this)); }
+
+    template <typename U>
+    void return_value(U&& value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    T TakeResult()
+    {
+        RethrowError();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+template <>
+class AsyncTaskPromise<void> : public AsyncTaskPromiseBase
+{
+public:
+    AsyncTask<void> get_return_object();
+    void return_void() {}
+    void TakeResult() { RethrowError(); }
+};
+
+// The result of a coroutine that can be awaited by other AsyncTask coroutines or waited for with Get(). An AsyncTask
+// that started owns its coroutine until it completes, so destroying one that is still running blocks until it is
+// done, like the std::future of std::async. One that never started doesn't run at all.
+template <typename T>
+class AsyncTask
+{
+public:
+    using promise_type = AsyncTaskPromise<T>;
+
+    AsyncTask() = default;
+    explicit AsyncTask(CoroutineHandle<promise_type> handle) : m_handle(handle) {}
+    AsyncTask(AsyncTask&& other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+    AsyncTask& operator=(AsyncTask&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Destroy();
+            m_handle = other.m_handle;
+            other.m_handle = nullptr;
+        }
+        return *this;
+    }
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+    ~AsyncTask() { Destroy(); }
+
+    // Starts the coroutine without waiting for it, for work that is collected later with Get(), WhenAll or WhenAny
+    void Start()
+    {
+        m_handle.promise().Start(m_handle, { [](void*) {}, nullptr });
+    }
+
+    bool IsCompleted() const { return m_handle && m_handle.promise().IsCompleted(); }
+
+    // Blocks until the coroutine has completed and returns its result or rethrows its exception. The result is moved
+    // out, so it can only be taken once.
+    T Get()
+    {
+        m_handle.promise().Wait(m_handle);
+        return m_handle.promise().TakeResult();
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(CoroutineHandle<> awaiting)
+    {
+        return m_handle.promise().Start(m_handle, { &ResumeAwaiting, awaiting.address() });
+    }
+    T await_resume() { return m_handle.promise().TakeResult(); }
+
+    // Runs continuation once the coroutine has completed, see AsyncTaskPromiseBase::Start
+    bool OnCompleted(AsyncContinuation continuation) { return m_handle.promise().Start(m_handle, continuation); }
+
+private:
+    static void ResumeAwaiting(void* awaiting) { CoroutineHandle<>::from_address(awaiting).resume(); }
+
+    void Destroy()
+    {
+        if (m_handle)
+        {
+            if (m_handle.promise().IsStarted())
+            {
+                m_handle.promise().Wait(m_handle);
+            }
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+    CoroutineHandle<promise_type> m_handle;
+};
+
+inline AsyncTask<void> AsyncTaskPromise<void>::get_return_object()
+{
+    return AsyncTask<void>(CoroutineHandle<AsyncTaskPromise>::from_promise(*this));
+}
+
+// co_await ResumeOn(pool) continues the coroutine on a worker of pool, so that the awaiting thread can go on with
+// other stages. Continues on the awaiting thread if the pool rejects the task, so pool must not drop tasks. Throws
+// TaskCancelled on the worker if the token was cancelled in the meantime.
+class ResumeOn
+{
+public:
+    explicit ResumeOn(ThreadPool& pool, CancellationToken cancellation = CancellationToken())
+        : m_pool(pool), m_cancellation(cancellation)
+    {
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(CoroutineHandle<> awaiting)
+    {
+        return m_pool.Post([awaiting]() { awaiting.resume(); });
+    }
+    void await_resume() const { m_cancellation.ThrowIfCancelled(); }
+
+private:
+    ThreadPool& m_pool;
+    CancellationToken m_cancellation;
+};
+
+// Starts all tasks and resumes the awaiting coroutine once every one of them has completed
+template <typename T>
+class WhenAllCompleted
+{
+public:
+    explicit WhenAllCompleted(std::vector<AsyncTask<T>>& tasks) : m_tasks(tasks), m_remaining(0) {}
+
+    bool await_ready() const { return m_tasks.empty(); }
+    bool await_suspend(CoroutineHandle<> awaiting)
+    {
+        m_awaiting = awaiting;
+        // One more than there are tasks, so the awaiting coroutine isn't resumed before all tasks have started
+        m_remaining = m_tasks.size() + 1;
+        for (AsyncTask<T>& task : m_tasks)
+        {
+            if (!task.OnCompleted({ &TaskCompleted, this }))
+            {
+                m_remaining--;
+            }
+        }
+        return --m_remaining > 0;
+    }
+    void await_resume() const {}
+
+private:
+    static void TaskCompleted(void* context)
+    {
+        auto self = static_cast<WhenAllCompleted*>(context);
+        if (--self->m_remaining == 0)
+        {
+            self->m_awaiting.resume();
+        }
+    }
+
+    std::vector<AsyncTask<T>>& m_tasks;
+    std::atomic<size_t> m_remaining;
+    CoroutineHandle<> m_awaiting;
+};
+
+// Runs the tasks concurrently and returns their results in order. If tasks failed, rethrows the exception of the
+// first of them once all have completed.
+template <typename T>
+AsyncTask<std::vector<T>> WhenAll(std::vector<AsyncTask<T>> tasks)
+{
+    co_await WhenAllCompleted<T>(tasks);
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (AsyncTask<T>& task : tasks)
+    {
+        results.push_back(co_await task);
+    }
+    co_return results;
+}
+
+inline AsyncTask<void> WhenAll(std::vector<AsyncTask<void>> tasks)
+{
+    co_await WhenAllCompleted<void>(tasks);
+    for (AsyncTask<void>& task : tasks)
+    {
+        co_await task;
+    }
+}
+
+// Starts all tasks and resumes the awaiting coroutine with the index of the first one to complete. The others keep
+// running, their AsyncTask waits for them when it is destroyed. Typically followed by cancelling the others.
+template <typename T>
+class WhenAnyCompleted
+{
+public:
+    explicit WhenAnyCompleted(std::vector<AsyncTask<T>>& tasks) : m_tasks(tasks)
+    {
+        if (tasks.empty())
+        {
+            throw std::invalid_argument("WhenAny needs at least one task");
+        }
+    }
+
+    bool await_ready() const { return false; }
+    bool await_suspend(CoroutineHandle<> awaiting)
+    {
+        // Tasks that complete after the awaiting coroutine resumed still refer to the state, so it is released by
+        // whoever is last: the tasks and await_resume
+        m_state = new State(m_tasks.size());
+        m_state->Awaiting = awaiting;
+        for (size_t index = 0; index < m_tasks.size(); index++)
+        {
+            if (!m_tasks[index].OnCompleted({ &TaskCompleted, &m_state->Entries[index] }))
+            {
+                TaskCompleted(&m_state->Entries[index]);
+            }
+        }
+        // Whichever of this and the first task to complete gets here second resumes the awaiting coroutine
+        return !m_state->IsArrived.exchange(true);
+    }
+    size_t await_resume()
+    {
+        size_t winner = m_state->Winner;
+        Release(m_state);
+        return winner;
+    }
+
+private:
+    struct State;
+    struct Entry
+    {
+        State* Owner;
+        size_t Index;
+    };
+    struct State
+    {
+        explicit State(size_t numTasks) : References(numTasks + 1), Entries(numTasks)
+        {
+            for (size_t index = 0; index < numTasks; index++)
+            {
+                Entries[index] = { this, index };
+            }
+        }
+
+        std::atomic<size_t> References;
+        std::atomic<bool> HasWinner{ false };
+        std::atomic<bool> IsArrived{ false };
+        size_t Winner = 0;
+        CoroutineHandle<> Awaiting;
+        std::vector<Entry> Entries;
+    };
+
+    static void Release(State* state)
+    {
+        if (--state->References == 0)
+        {
+            delete state;
+        }
+    }
+
+    static void TaskCompleted(void* context)
+    {
+        auto entry = static_cast<Entry*>(context);
+        State* state = entry->Owner;
+        if (!state->HasWinner.exchange(true))
+        {
+            state->Winner = entry->Index;
+            if (state->IsArrived.exchange(true))
+            {
+                state->Awaiting.resume();
+            }
+        }
+        Release(state);
+    }
+
+    std::vector<AsyncTask<T>>& m_tasks;
+    State* m_state = nullptr;
+};
+
+// The tasks must outlive the returned task, their results are taken from them once they have completed
+template <typename T>
+AsyncTask<size_t> WhenAny(std::vector<AsyncTask<T>>& tasks)
+{
+    co_return co_await WhenAnyCompleted<T>(tasks);
+}
@@ -11,6 +11,7 @@
 #include "CommandLineArgs.h"
 #include "OutputHelper.h"
 #include "BindingUtilities.h"
+#include "Parallel.h"
 using namespace winrt::Windows::Media;
 using namespace winrt::Windows::Storage;
 using namespace winrt::Windows::Storage::Streams;
@@ -25,16 +26,16 @@ using namespace winrt::Windows::Graphics::Imaging;
 using namespace winrt::Windows::Graphics::DirectX::Direct3D11;
 using namespace DirectX::PackedVector;
 
-inline size_t hash_data(void const* ptr, size_t const bytes) noexcept
-{
 #ifdef _WIN64
-    constexpr size_t fnv_offset_basis = 14695981039346656037ULL;
-    constexpr size_t fnv_prime = 1099511628211ULL;
+constexpr size_t fnv_offset_basis = 14695981039346656037ULL;
+constexpr size_t fnv_prime = 1099511628211ULL;
 #else
-    constexpr size_t fnv_offset_basis = 2166136261U;
-    constexpr size_t fnv_prime = 16777619U;
+constexpr size_t fnv_offset_basis = 2166136261U;
+constexpr size_t fnv_prime = 16777619U;
 #endif
-    size_t result = fnv_offset_basis;
+
+inline size_t fnv_hash(size_t result, void const* ptr, size_t const bytes) noexcept
+{
     uint8_t const* const buffer = static_cast<uint8_t const*>(ptr);
 
     for (size_t next = 0; next < bytes; ++next)
@@ -46,6 +47,23 @@ inline size_t hash_data(void const* ptr, size_t const bytes) noexcept
     return result;
 }
 
+// FNV-1a of the data. Data larger than one block is hashed block by block in parallel, and the hash is the FNV-1a of
+// the block hashes in order, so hashes of data up to one block are unchanged.
+inline size_t hash_data(void const* ptr, size_t const bytes)
+{
+    constexpr size_t block_size = 1 << 20;
+    uint8_t const* const buffer = static_cast<uint8_t const*>(ptr);
+    if (bytes <= block_size)
+    {
+        return fnv_hash(fnv_offset_basis, buffer, bytes);
+    }
+
+    return ParallelReduce(
+        0, bytes, block_size, fnv_offset_basis,
+        [buffer](size_t first, size_t last) { return fnv_hash(fnv_offset_basis, buffer + first, last - first); },
+        [](size_t result, size_t block_hash) { return fnv_hash(result, &block_hash, sizeof(block_hash)); });
+}
+
 template <TensorKind T> struct TensorKindToPointerType
 {
     static_assert(true, "No TensorKind mapped for given type!");
@@ -267,10 +285,12 @@ namespace BindingUtilities
                                                     static_cast<int32_t>(width), static_cast<int32_t>(height));
     }
 
-    SoftwareBitmap LoadImageFile(const ILearningModelFeatureDescriptor& modelFeatureDescriptor,
-                                 const InputDataType inputDataType, const hstring& filePath,
-                                 const CommandLineArgs& args, uint32_t iterationNum,
-                                 ColorManagementMode colorManagementMode)
+    // Opens and decodes the image without blocking a thread while waiting for the file system or the decoder. The
+    // arguments are copied into the coroutine, except args which must outlive it.
+    AsyncTask<SoftwareBitmap> LoadImageFileAsync(ILearningModelFeatureDescriptor modelFeatureDescriptor,
+                                                 InputDataType inputDataType, hstring filePath,
+                                                 const CommandLineArgs& args, uint32_t iterationNum,
+                                                 ColorManagementMode colorManagementMode)
     {
         // We assume NCHW and NCDHW
         uint64_t width = 0;
@@ -281,11 +301,11 @@ namespace BindingUtilities
         try
         {
             // open the file
-            StorageFile file = StorageFile::GetFileFromPathAsync(filePath).get();
+            StorageFile file = co_await StorageFile::GetFileFromPathAsync(filePath);
             // get a stream on it
-            stream = file.OpenAsync(FileAccessMode::Read).get();
+            stream = co_await file.OpenAsync(FileAccessMode::Read);
             // Create the decoder from the stream
-            decoder = BitmapDecoder::CreateAsync(stream).get();
+            decoder = co_await BitmapDecoder::CreateAsync(stream);
         }
         catch (hresult_error hr)
         {
@@ -312,18 +332,17 @@ namespace BindingUtilities
                 transform.InterpolationMode(args.AutoScaleInterpMode());
 
                 // get the bitmap
-                return decoder
-                    .GetSoftwareBitmapAsync(format, decoder.BitmapAlphaMode(), transform,
-                                            ExifOrientationMode::RespectExifOrientation, colorManagementMode)
-                    .get();
+                co_return co_await decoder.GetSoftwareBitmapAsync(format, decoder.BitmapAlphaMode(), transform,
+                                                                  ExifOrientationMode::RespectExifOrientation,
+                                                                  colorManagementMode);
             }
             else
             {
                 // get the bitmap
-                return decoder
-                    .GetSoftwareBitmapAsync(format, decoder.BitmapAlphaMode(), BitmapTransform(),
-                                            ExifOrientationMode::RespectExifOrientation, colorManagementMode)
-                    .get();
+                co_return co_await decoder.GetSoftwareBitmapAsync(format, decoder.BitmapAlphaMode(),
+                                                                  BitmapTransform(),
+                                                                  ExifOrientationMode::RespectExifOrientation,
+                                                                  colorManagementMode);
             }
         }
         catch (hresult_error hr)
@@ -335,6 +354,16 @@ namespace BindingUtilities
         }
     }
 
+    SoftwareBitmap LoadImageFile(const ILearningModelFeatureDescriptor& modelFeatureDescriptor,
+                                 const InputDataType inputDataType, const hstring& filePath,
+                                 const CommandLineArgs& args, uint32_t iterationNum,
+                                 ColorManagementMode colorManagementMode)
+    {
+        return LoadImageFileAsync(modelFeatureDescriptor, inputDataType, filePath, args, iterationNum,
+                                  colorManagementMode)
+            .Get();
+    }
+
     VideoFrame CreateVideoFrame(const SoftwareBitmap& softwareBitmap, InputBindingType inputBindingType,
                                 InputDataType inputDataType, const IDirect3DDevice winrtDevice)
     {
@@ -376,21 +405,28 @@ namespace BindingUtilities
         }
     };
 
-    void ReadCSVIntoBuffer(const std::wstring& csvFilePath, InputBufferDesc& inputBufferDesc)
+    // Reads the file without blocking a thread while waiting for the file system. inputBufferDesc must outlive the
+    // coroutine.
+    AsyncTask<void> ReadCSVIntoBufferAsync(std::wstring csvFilePath, InputBufferDesc& inputBufferDesc)
     {
-        std::ifstream fileStream;
-        fileStream.open(csvFilePath);
-        if (!fileStream.is_open())
+        hstring text;
+        try
+        {
+            StorageFile file = co_await StorageFile::GetFileFromPathAsync(csvFilePath);
+            text = co_await FileIO::ReadTextAsync(file);
+        }
+        catch (hresult_error)
         {
             ThrowFailure(L"BindingUtilities: could not open data file.");
         }
+        std::wistringstream fileStream{ std::wstring(text) };
 
         uint32_t pos = 0;
-        std::string line;
+        std::wstring line;
         float_t* pData = (float_t*)inputBufferDesc.elements;
         uint32_t expectedPos = (inputBufferDesc.totalSizeInBytes * inputBufferDesc.numChannelsPerElement) /
                                inputBufferDesc.elementStrideInBytes;
-        while (std::getline(fileStream, line, ','))
+        while (std::getline(fileStream, line, L','))
         {
             if (pos > expectedPos)
                 throw hresult_invalid_argument(L"Too many elements in CSV file to fit in input of what model expects!");
@@ -409,6 +445,11 @@ namespace BindingUtilities
         }
     }
 
+    void ReadCSVIntoBuffer(const std::wstring& csvFilePath, InputBufferDesc& inputBufferDesc)
+    {
+        ReadCSVIntoBufferAsync(csvFilePath, inputBufferDesc).Get();
+    }
+
     // Roll the array correctly for the tensor
     template <TensorKind TKind, typename InputType>
     void CopyTensorFromBuffer(void* actualData, uint32_t tensorHeight, uint32_t tensorWidth,
@@ -418,35 +459,43 @@ namespace BindingUtilities
         using WriteType = typename TensorKindToPointerType<TKind>::Type;
 
         WriteType* pDataOut = static_cast<WriteType*>(actualData);
-        InputType* pDataIn = (InputType*)inputBufferDesc.elements;
         uint32_t elementOffsetMultiplier = inputBufferDesc.isPlanar ? inputBufferDesc.numChannelsPerElement : 1;
         uint32_t channelOffsetMultiplier = inputBufferDesc.isPlanar ? 1 : tensorHeight * tensorWidth;
-        for (uint32_t element = 0; element < tensorHeight * tensorWidth; ++element)
-        {
-            for (uint32_t channel = 0; channel < inputBufferDesc.numChannelsPerElement; ++channel)
+        size_t elementStride = inputBufferDesc.elementStrideInBytes / sizeof(InputType);
+        // Every element is converted independently, so large images are split across threads
+        ParallelFor(0, static_cast<size_t>(tensorHeight) * tensorWidth, 0, [&](size_t first, size_t last) {
+            InputType* pDataIn = (InputType*)inputBufferDesc.elements + first * elementStride;
+            for (size_t element = first; element < last; ++element)
             {
-                pDataOut[element * elementOffsetMultiplier + channel * channelOffsetMultiplier] =
-                    ConvertToPointerType<TKind, WriteType>(((pDataIn[channel] / scale) - means[channel]) /
-                                                           stddevs[channel]);
+                for (uint32_t channel = 0; channel < inputBufferDesc.numChannelsPerElement; ++channel)
+                {
+                    pDataOut[element * elementOffsetMultiplier + channel * channelOffsetMultiplier] =
+                        ConvertToPointerType<TKind, WriteType>(((pDataIn[channel] / scale) - means[channel]) /
+                                                               stddevs[channel]);
+                }
+                pDataIn += elementStride;
             }
-            pDataIn += inputBufferDesc.elementStrideInBytes / sizeof(InputType);
-        }
+        });
     }
 
+    // Every chunk of the data draws from its own engine, seeded from the call's seed and the chunk index, so the data
+    // only depends on the seed and is generated in parallel.
     template <TensorKind TKind, typename WriteType>
     static void GenerateRandomData(WriteType* data, uint32_t sizeInBytes, uint32_t maxValue)
     {
-        static std::independent_bits_engine<std::default_random_engine, sizeof(uint32_t) * 8, uint32_t>
-            randomBitsEngine;
-        randomBitsEngine.seed(seed++);
-
-        WriteType* begin = data;
-        WriteType* end = reinterpret_cast<WriteType*>(reinterpret_cast<BYTE*>(data) + sizeInBytes);
-        while (begin <= end)
-        {
-            *begin = maxValue * static_cast<float>(randomBitsEngine()) / (randomBitsEngine.max)();
-            ++begin;
-        }
+        unsigned int callSeed = seed++;
+        size_t numValues = sizeInBytes / sizeof(WriteType);
+        size_t grain = GetParallelGrain(0, numValues, 0);
+        ParallelFor(0, numValues, grain, [&](size_t first, size_t last) {
+            std::seed_seq chunkSeed = { callSeed, static_cast<unsigned int>(first / grain) };
+            std::independent_bits_engine<std::default_random_engine, sizeof(uint32_t) * 8, uint32_t>
+                randomBitsEngine;
+            randomBitsEngine.seed(chunkSeed);
+            for (size_t value = first; value < last; ++value)
+            {
+                data[value] = maxValue * static_cast<float>(randomBitsEngine()) / (randomBitsEngine.max)();
+            }
+        });
     }
 
     template <TensorKind TKind>
@@ -473,13 +522,16 @@ namespace BindingUtilities
             uint32_t tensorHeight = static_cast<uint32_t>(tensorShape[2]);
             uint32_t tensorWidth = static_cast<uint32_t>(tensorShape[3]);
 
-            // Check to make sure the sizes are right
+            // Check to make sure the sizes are right. The input holds either the whole tensor or a single sample
+            // that is replicated across the batch.
             uint32_t inputElementCount = inputBufferDesc.totalSizeInBytes / inputBufferDesc.elementStrideInBytes;
             uint32_t outputElementCount = actualSizeInBytes / (channels * sizeof(WriteType));
-            if (inputElementCount != outputElementCount)
+            uint32_t batchSize = static_cast<uint32_t>(tensorShape[0]);
+            if (inputElementCount != outputElementCount && inputElementCount * batchSize != outputElementCount)
             {
                 throw hresult_invalid_argument(L"Input size / shape is different from what the model expects");
             }
+            uint32_t numSamples = outputElementCount / inputElementCount;
 
             float scale;
             std::vector<float> means = {};
@@ -543,6 +595,13 @@ namespace BindingUtilities
                 default:
                     throw hresult_not_implemented(L"Creating Tensors for Input Images with unhandled channel format!");
             }
+
+            // Tensorize the sample once and copy it to the rest of the batch
+            uint32_t sampleElementCount = inputElementCount * channels;
+            for (uint32_t sample = 1; sample < numSamples; ++sample)
+            {
+                std::copy_n(actualData, sampleElementCount, actualData + sample * sampleElementCount);
+            }
         }
         // Garbage Data
         else if (args.IsGarbageDataRange())
@@ -643,9 +702,10 @@ namespace BindingUtilities
         }
     }
 
-    // Process the descriptor to gather and normalize the shape
-    void ProcessDescriptor(const ILearningModelFeatureDescriptor& description, std::vector<int64_t>& shape,
-                           TensorKind& tensorKind, InputBufferDesc& inputBufferDesc)
+    // Process the descriptor to gather and normalize the shape. A free batch dimension is set to batchSize and every
+    // other free dimension to 1.
+    void ProcessDescriptor(const ILearningModelFeatureDescriptor& description, uint32_t batchSize,
+                           std::vector<int64_t>& shape, TensorKind& tensorKind, InputBufferDesc& inputBufferDesc)
     {
         // Try Image Feature Descriptor
         auto imageFeatureDescriptor = description.try_as<ImageFeatureDescriptor>();
@@ -669,7 +729,7 @@ namespace BindingUtilities
             }
 
             tensorKind = TensorKind::Float;
-            shape.push_back(1);
+            shape.push_back(batchSize);
             shape.push_back(channels);
             shape.push_back(static_cast<int64_t>(imageFeatureDescriptor.Height()));
             shape.push_back(static_cast<int64_t>(imageFeatureDescriptor.Width()));
@@ -692,7 +752,7 @@ namespace BindingUtilities
                 {
                     if (dimSize == -1)
                     {
-                        shape.push_back(1);
+                        shape.push_back(dim == 0 ? batchSize : 1);
                     }
                     else
                     {
@@ -719,7 +779,7 @@ namespace BindingUtilities
 
         std::vector<int64_t> shape = {};
         TensorKind tensorKind = TensorKind::Undefined;
-        ProcessDescriptor(description, shape, tensorKind, inputBufferDesc);
+        ProcessDescriptor(description, args.BatchSize(), shape, tensorKind, inputBufferDesc);
 
         SoftwareBitmap softwareBitmap(nullptr);
         if (args.IsCSVInput())
@@ -733,8 +793,9 @@ namespace BindingUtilities
             // Assumes no gaps in the input csv file
             inputBufferDesc.elementStrideInBytes = inputBufferDesc.numChannelsPerElement * sizeof(float_t);
 
+            // When sweeping batch sizes the CSV file holds a single sample that is replicated across the batch
             inputBufferDesc.totalSizeInBytes = sizeof(float_t);
-            for (uint32_t i = 0; i < shape.size(); ++i)
+            for (uint32_t i = args.IsBatchSizeSweep() ? 1 : 0; i < shape.size(); ++i)
                 inputBufferDesc.totalSizeInBytes *= static_cast<uint32_t>(shape[i]);
 
             inputBufferDesc.elements = new uint8_t[inputBufferDesc.totalSizeInBytes];
@@ -866,6 +927,64 @@ namespace BindingUtilities
         return ImageFeatureValue::CreateFromVideoFrame(videoFrame);
     }
 
+    // Creates an empty tensor for an output feature that can be bound once and reused by every evaluation. Outputs that
+    // are string tensors or have free dimensions other than the batch dimension are left to WinML to allocate.
+    ITensor CreateBindableOutputTensor(const ILearningModelFeatureDescriptor& description, uint32_t batchSize)
+    {
+        auto tensorDescriptor = description.try_as<TensorFeatureDescriptor>();
+        if (!tensorDescriptor)
+        {
+            return nullptr;
+        }
+        std::vector<int64_t> shape;
+        IVectorView<int64_t> tensorShape = tensorDescriptor.Shape();
+        for (uint32_t dim = 0; dim < tensorShape.Size(); dim++)
+        {
+            int64_t dimSize = tensorShape.GetAt(dim);
+            if (dimSize > 0)
+            {
+                shape.push_back(dimSize);
+            }
+            else if (dim == 0 && dimSize == -1)
+            {
+                shape.push_back(batchSize);
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+        switch (tensorDescriptor.TensorKind())
+        {
+            case TensorKind::Float:
+                return TensorFloat::Create(shape);
+            case TensorKind::Float16:
+                return TensorFloat16Bit::Create(shape);
+            case TensorKind::Double:
+                return TensorDouble::Create(shape);
+            case TensorKind::Int8:
+                return TensorInt8Bit::Create(shape);
+            case TensorKind::UInt8:
+                return TensorUInt8Bit::Create(shape);
+            case TensorKind::Int16:
+                return TensorInt16Bit::Create(shape);
+            case TensorKind::UInt16:
+                return TensorUInt16Bit::Create(shape);
+            case TensorKind::Int32:
+                return TensorInt32Bit::Create(shape);
+            case TensorKind::UInt32:
+                return TensorUInt32Bit::Create(shape);
+            case TensorKind::Int64:
+                return TensorInt64Bit::Create(shape);
+            case TensorKind::UInt64:
+                return TensorUInt64Bit::Create(shape);
+            case TensorKind::Boolean:
+                return TensorBoolean::Create(shape);
+            default:
+                return nullptr;
+        }
+    }
+
     template <typename K, typename V>
     void OutputSequenceBinding(IMapView<hstring, winrt::Windows::Foundation::IInspectable> results, hstring name)
     {
@@ -912,10 +1031,10 @@ namespace BindingUtilities
                 int size = 0;
                 unsigned int topK = args.TopK();
                 std::vector<std::pair<float, int>> maxKValues;
-                std::ofstream fout;
+                // Formatted here while the tensor is valid and written in the background
+                std::ostringstream fout;
                 if (args.IsSaveTensor())
                 {
-                    fout.open(output.GetCsvFileNamePerIterationResult(), std::ios_base::app);
                     fout << "Index"
                          << ","
                          << "Value" << std::endl;
@@ -962,15 +1081,15 @@ namespace BindingUtilities
                 }
                 if (args.IsSaveTensor())
                 {
-                    fout.close();
+                    output.AppendToFileInBackground(output.GetCsvFileNamePerIterationResult(), fout.str());
+                    int hash = static_cast<int>(hash_data(tensor, uCapacity));
                     for (auto& pair : maxKValues)
                     {
                         auto maxValue = pair.first;
                         auto maxIndex = pair.second;
                         std::string iterationResult =
                             "Index: " + std::to_string(maxIndex) + "; Value: " + std::to_string(maxValue);
-                        output.SaveResult(iterationNum, iterationResult,
-                                          static_cast<int>(hash_data(tensor, uCapacity)));
+                        output.SaveResult(iterationNum, iterationResult, hash);
                     }
                 }
                 if (!args.IsGarbageInput() && iterationNum == 0)
@@ -18,6 +18,8 @@ namespace BindingUtilities
                                           const CommandLineArgs& args, uint32_t iterationNum,
                                           ColorManagementMode colorManagementMode);
 
+    ITensor CreateBindableOutputTensor(const ILearningModelFeatureDescriptor& description, uint32_t batchSize);
+
     void PrintOrSaveEvaluationResults(const LearningModel& model, const CommandLineArgs& args,
                                       const winrt::Windows::Foundation::Collections::IMapView<hstring, winrt::Windows::Foundation::IInspectable>& results,
                                       OutputHelper& output, int iterationNum);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// A fixed capacity multi-producer multi-consumer queue that doesn't take locks. Every cell carries a sequence number
+// that tells producers and consumers whose turn it is, so they only contend on the cell they claim. TryPush and TryPop
+// never block; they return false when the queue is full or empty.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity == 0 ? 1 : capacity), m_num_cells(m_capacity < 2 ? 2 : m_capacity)
+    {
+        m_cells = std::make_unique<Cell[]>(m_num_cells);
+        for (size_t i = 0; i < m_num_cells; i++)
+        {
+            m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    size_t Capacity() const { return m_capacity; }
+
+    // Moves from value only if there was room for it
+    bool TryPush(T& value)
+    {
+        size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[position % m_num_cells];
+            size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+            if (difference == 0)
+            {
+                // The dequeue position only grows, so a stale read can report the queue full but never lets it hold
+                // more than the capacity
+                if (m_num_cells > m_capacity &&
+                    position - m_dequeue_position.load(std::memory_order_acquire) >= m_capacity)
+                {
+                    return false;
+                }
+                if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.m_value = std::move(value);
+                    cell.m_sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // The cell still holds the value pushed one lap ago
+                return false;
+            }
+            else
+            {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool TryPop(T& value)
+    {
+        size_t position = m_dequeue_position.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Cell& cell = m_cells[position % m_num_cells];
+            size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+            ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position + 1);
+            if (difference == 0)
+            {
+                if (m_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.m_value);
+                    cell.m_sequence.store(position + m_num_cells, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                // Nothing has been pushed into the cell yet
+                return false;
+            }
+            else
+            {
+                position = m_dequeue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t CacheLineSize = 64;
+
+    struct alignas(CacheLineSize) Cell
+    {
+        std::atomic<size_t> m_sequence;
+        T m_value;
+    };
+
+    // Producers and consumers update their positions on separate cache lines so they don't invalidate each other
+    alignas(CacheLineSize) std::atomic<size_t> m_enqueue_position{ 0 };
+    alignas(CacheLineSize) std::atomic<size_t> m_dequeue_position{ 0 };
+    alignas(CacheLineSize) const size_t m_capacity;
+    // A single cell can't tell a full queue from an empty one, as its sequence is the same after a push as the next
+    // position, so a capacity of 1 still uses two cells
+    const size_t m_num_cells;
+    std::unique_ptr<Cell[]> m_cells;
+};
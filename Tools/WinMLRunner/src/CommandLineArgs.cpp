@@ -55,7 +55,10 @@ void CommandLineArgs::PrintUsage()
     std::cout << "  -Perf [all]: capture performance measurements such as timing and memory usage. Specifying \"all\" "
                  "will output all measurements"
               << std::endl;
-    std::cout << "  -Iterations : # times perf measurements will be run/averaged. (maximum: 1024 times)" << std::endl;
+    std::cout << "  -PerfTimingOnly : only time load, session creation, bind and evaluate, without reading the CPU, "
+                 "memory and GPU counters, whose cost would inflate the times of small models"
+              << std::endl;
+    std::cout << "  -Iterations : # times perf measurements will be run/averaged." << std::endl;
     std::cout << "  -Input <path to input file>: binds image or CSV to model" << std::endl;
     std::cout << "  -InputImageFolder <path to directory of images> : specify folder of images to bind to model"
               << std::endl;
@@ -78,13 +81,89 @@ void CommandLineArgs::PrintUsage()
     std::cout << "  -AutoScale <interpolationMode> : Enable image autoscaling and set the interpolation mode [Nearest, "
                  "Linear, Cubic, Fant]"
               << std::endl;
+    std::cout << "  -Pipeline <depth> : bind the inputs of the next iterations on a worker thread while the current "
+                 "iteration evaluates, cycling through <depth> bindings (minimum: 2)"
+              << std::endl;
+    std::cout << "  -CacheInputFeatures [<variants>] : generate each input feature once and reuse it across iterations. "
+                 "Garbage inputs cycle through <variants> pre-generated values (default: 4). With -Perf, the cache hit "
+                 "rate is reported for every model and device"
+              << std::endl;
+    std::cout << "  -AsyncDepth <n> : keep up to <n> asynchronous evaluations in flight and report submit to complete "
+                 "latency and completions/sec"
+              << std::endl;
+    std::cout << "  -OpenLoop <rate> [Constant|Poisson] : issue <rate> evaluations per second on -NumThreads workers "
+                 "regardless of completions and report latency from the intended start time (default: Constant)"
+              << std::endl;
+    std::cout << "  -MaxQueueDepth <n> [Block|Reject|DropOldest] : queue at most <n> -OpenLoop requests. When the "
+                 "queue is full, block the dispatcher, reject the request or drop the oldest queued request (default: "
+                 "Block). Also bounds the queue of the -ThreadPoolBenchmark bounded queue pool, which always blocks "
+                 "(default: 1024)"
+              << std::endl;
+    std::cout << "  -AdaptiveIterations [Mean|Median] : warm up until evaluate times are stable, then evaluate until "
+                 "the confidence interval of the mean or median is within -TargetRelativeError. -Iterations becomes "
+                 "the maximum (default: 1024). Requires -Perf"
+              << std::endl;
+    std::cout << "  -WarmupCV <value> : coefficient of variation of the last 10 evaluate times below which warm-up ends "
+                 "(default: 0.05)"
+              << std::endl;
+    std::cout << "  -TargetRelativeError <value> : relative half-width of the 95% confidence interval at which "
+                 "adaptive iterations stop (default: 0.02)"
+              << std::endl;
+    std::cout << "  -PrefetchModels <number> : load up to <number> models ahead on background threads while the "
+                 "current model is evaluated"
+              << std::endl;
+    std::cout << "  -PrefetchMemoryLimit <MB> : maximum combined file size of models loaded ahead (default: 2048, 0: no "
+                 "limit)"
+              << std::endl;
+    std::cout << "  -PrefetchSessions : also create a session per device for models loaded ahead" << std::endl;
+    std::cout << "  -BatchSize <sizes> : comma separated batch sizes to evaluate, with one session per batch size. "
+                 "Requires tensor binding and a version of Windows with LearningModelSessionOptions.BatchSizeOverride. "
+                 "An -Input image or CSV holds one sample, which is copied to every row of the batch, so the rows are "
+                 "identical. Generated input is random in every row"
+              << std::endl;
+    std::cout << "  -SessionCreationIterations <number> : number of times a session is created for each configuration. "
+                 "Implies -RecreateSession when greater than 1"
+              << std::endl;
+    std::cout << "  -RecreateSession : create a new session for every input configuration and session creation "
+                 "iteration instead of reusing one session per model, device and batch size"
+              << std::endl;
+    std::cout << "  -BindOutputs : also evaluate each configuration with output tensors that are allocated once and "
+                 "bound every iteration, and report both runs. The order of the two runs alternates between "
+                 "configurations"
+              << std::endl;
     std::cout << std::endl;
     std::cout << "Concurrency Options:" << std::endl;
-    std::cout << "  -ConcurrentLoad: load models concurrently" << std::endl;
-    std::cout << "  -NumThreads <number>: number of threads to load a model. By default this will be the number of "
-                 "model files to be executed"
+    std::cout << "  -ConcurrentLoad: measure how loading the models and evaluating them with threads sharing one session "
+                 "or one model scale from 1 up to -NumThreads threads. -PerfOutput writes the scaling curve to "
+                 "<perf>_scaling.csv"
+              << std::endl;
+    std::cout << "  -NumThreads <number>: maximum number of threads for -ConcurrentLoad, number of workers for -OpenLoop"
+              << std::endl;
+    std::cout << "  -MaxThreads <number>: let the -OpenLoop and -PrefetchModels pools add workers up to <number> while "
+                 "every worker is busy and requests wait, and retire the added workers once they are idle"
+              << std::endl;
+    std::cout << "  -ThreadPoolStats: report how long -OpenLoop requests wait in the pool's queue and run, how long "
+                 "the pool's lock is waited for and held, the queue length and how busy the workers are"
               << std::endl;
-    std::cout << "  -ThreadInterval <milliseconds>: interval time between two thread creations in milliseconds"
+    std::cout << "  -ThreadInterval <milliseconds>: interval time between two loading threads starting in milliseconds"
+              << std::endl;
+    std::cout << "  -Throughput <sessions>x<threads>: evaluate <sessions> sessions per device with <threads> threads "
+                 "each and report aggregate inferences/sec and scaling efficiency against a single session"
+              << std::endl;
+    std::cout << "  -SweepWorkers <number>: run every model, device and input binding combination in its own worker "
+                 "process, <number> at a time, each pinned to a disjoint set of CPUs, and merge their perf results. "
+                 "Implies -Perf"
+              << std::endl;
+    std::cout << "  -JobTimeout <seconds>: terminate sweep jobs that run longer than <seconds>" << std::endl;
+    std::cout << "  -ThreadPlacement <None|Pack|Spread>: pin the worker threads of -OpenLoop, -Throughput, "
+                 "-ConcurrentLoad and -ThreadPoolBenchmark to logical processors. Pack fills the SMT siblings of a "
+                 "core, then the cores of a NUMA node. Spread puts one worker on every physical core, alternating "
+                 "between NUMA nodes, before using SMT siblings (default: None)"
+              << std::endl;
+    std::cout << "  -ThreadPoolBenchmark [<tasks>]: compare the mutex, bounded queue and work-stealing thread pools on "
+                 "<tasks> small tasks submitted with SubmitWork and with Post from as many threads as the pool has "
+                 "workers, with 1 up to -NumThreads workers (default: 100000 tasks, all CPUs). Doesn't need a model. "
+                 "-PerfOutput writes the results to <perf>_scaling.csv"
               << std::endl;
 }
 
@@ -102,11 +181,12 @@ void CheckAPICall(int return_value)
 #pragma warning(push)
 #pragma warning(disable : 4996)
 
-CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
+CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args) : m_arguments(args)
 {
     std::wstring sPerfOutputPath;
     std::wstring sBaseOutputPath;
     std::wstring sPerIterationDataPath;
+    bool isIterationsSpecified = false;
 
     for (UINT i = 0; i < args.size(); i++)
     {
@@ -153,6 +233,7 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
         else if ((_wcsicmp(args[i].c_str(), L"-Iterations") == 0) && (i + 1 < args.size()))
         {
             m_numIterations = static_cast<UINT>(_wtoi(args[++i].c_str()));
+            isIterationsSpecified = true;
         }
         else if ((_wcsicmp(args[i].c_str(), L"-Model") == 0))
         {
@@ -248,6 +329,10 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
             }
             m_perfCapture = true;
         }
+        else if ((_wcsicmp(args[i].c_str(), L"-PerfTimingOnly") == 0))
+        {
+            TogglePerfTimingOnly(true);
+        }
         else if ((_wcsicmp(args[i].c_str(), L"-DebugEvaluate") == 0))
         {
             if (!IsDebuggerPresent())
@@ -369,12 +454,119 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
             unsigned num_threads = std::stoi(args[++i].c_str());
             SetNumThreads(num_threads);
         }
+        else if ((_wcsicmp(args[i].c_str(), L"-MaxThreads") == 0))
+        {
+            CheckNextArgument(args, i);
+            unsigned max_threads = std::stoi(args[++i].c_str());
+            if (max_threads == 0)
+            {
+                throw hresult_invalid_argument(L"-MaxThreads must be greater than 0!");
+            }
+            SetMaxThreads(max_threads);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-ThreadPoolStats") == 0))
+        {
+            ToggleThreadPoolStats(true);
+        }
         else if ((_wcsicmp(args[i].c_str(), L"-ThreadInterval") == 0))
         {
             CheckNextArgument(args, i);
             unsigned thread_interval = std::stoi(args[++i].c_str());
             SetThreadInterval(thread_interval);
         }
+        else if ((_wcsicmp(args[i].c_str(), L"-ThreadPlacement") == 0))
+        {
+            CheckNextArgument(args, i);
+            if (_wcsicmp(args[++i].c_str(), L"None") == 0)
+            {
+                SetThreadPlacement(ThreadPlacement::None);
+            }
+            else if (_wcsicmp(args[i].c_str(), L"Pack") == 0)
+            {
+                SetThreadPlacement(ThreadPlacement::Pack);
+            }
+            else if (_wcsicmp(args[i].c_str(), L"Spread") == 0)
+            {
+                SetThreadPlacement(ThreadPlacement::Spread);
+            }
+            else
+            {
+                PrintUsage();
+                throw hresult_invalid_argument(L"Unknown ThreadPlacement!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-ThreadPoolBenchmark") == 0))
+        {
+            SetThreadPoolBenchmarkTasks(100000);
+            if (i + 1 < args.size() && args[i + 1][0] != L'-')
+            {
+                SetThreadPoolBenchmarkTasks(std::stoul(args[++i].c_str()));
+                if (ThreadPoolBenchmarkTasks() == 0)
+                {
+                    throw hresult_invalid_argument(L"-ThreadPoolBenchmark needs at least one task!");
+                }
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-Throughput") == 0))
+        {
+            CheckNextArgument(args, i);
+            std::wstring throughput = args[++i];
+            size_t separator = throughput.find_first_of(L"xX");
+            unsigned sessions = std::stoul(throughput.substr(0, separator));
+            unsigned threadsPerSession =
+                separator == std::wstring::npos ? 1 : std::stoul(throughput.substr(separator + 1));
+            if (sessions == 0 || threadsPerSession == 0)
+            {
+                throw hresult_invalid_argument(L"-Throughput needs at least one session and one thread per session!");
+            }
+            SetThroughput(sessions, threadsPerSession);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-PrefetchModels") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetPrefetchModels(std::stoul(args[++i].c_str()));
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-PrefetchMemoryLimit") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetPrefetchMemoryLimit(std::stoul(args[++i].c_str()));
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-PrefetchSessions") == 0))
+        {
+            TogglePrefetchSessions(true);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-SessionCreationIterations") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetSessionCreationIterations(std::stoul(args[++i].c_str()));
+            if (NumSessionCreationIterations() == 0)
+            {
+                throw hresult_invalid_argument(L"-SessionCreationIterations must be at least 1!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-RecreateSession") == 0))
+        {
+            ToggleRecreateSession(true);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-BindOutputs") == 0))
+        {
+            ToggleBindOutputs(true);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-SweepWorkers") == 0))
+        {
+            CheckNextArgument(args, i);
+            int workers = std::stoi(args[++i].c_str());
+            if (workers < 1)
+            {
+                throw hresult_invalid_argument(L"-SweepWorkers needs at least one worker!");
+            }
+            SetSweepWorkers(static_cast<uint32_t>(workers));
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-JobTimeout") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetJobTimeout(std::stoul(args[++i].c_str()));
+        }
         else if ((_wcsicmp(args[i].c_str(), L"-TopK") == 0))
         {
             CheckNextArgument(args, i);
@@ -385,6 +577,153 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
             CheckNextArgument(args, i);
             SetGarbageDataMaxValue(std::stoul(args[++i].c_str()));
         }
+        else if ((_wcsicmp(args[i].c_str(), L"-Pipeline") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetPipelineDepth(std::stoul(args[++i].c_str()));
+            if (m_pipelineDepth < 2)
+            {
+                throw hresult_invalid_argument(L"-Pipeline depth must be at least 2!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-AsyncDepth") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetAsyncDepth(std::stoul(args[++i].c_str()));
+            if (m_asyncDepth == 0)
+            {
+                throw hresult_invalid_argument(L"-AsyncDepth must be at least 1!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-AdaptiveIterations") == 0))
+        {
+            AdaptiveStatistic statistic = AdaptiveStatistic::Mean;
+            if (i + 1 < args.size() && args[i + 1][0] != L'-')
+            {
+                if (_wcsicmp(args[++i].c_str(), L"Mean") == 0)
+                {
+                    statistic = AdaptiveStatistic::Mean;
+                }
+                else if (_wcsicmp(args[i].c_str(), L"Median") == 0)
+                {
+                    statistic = AdaptiveStatistic::Median;
+                }
+                else
+                {
+                    PrintUsage();
+                    throw hresult_invalid_argument(L"Unknown AdaptiveIterations statistic!");
+                }
+            }
+            SetAdaptiveIterations(statistic);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-WarmupCV") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetWarmupCV(std::stod(args[++i].c_str()));
+            if (m_warmupCV <= 0)
+            {
+                throw hresult_invalid_argument(L"-WarmupCV must be greater than 0!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-TargetRelativeError") == 0))
+        {
+            CheckNextArgument(args, i);
+            SetTargetRelativeError(std::stod(args[++i].c_str()));
+            if (m_targetRelativeError <= 0)
+            {
+                throw hresult_invalid_argument(L"-TargetRelativeError must be greater than 0!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-BatchSize") == 0))
+        {
+            CheckNextArgument(args, i);
+            std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+            std::istringstream batchSizes(converter.to_bytes(args[++i]));
+            std::string batchSize;
+            while (std::getline(batchSizes, batchSize, ','))
+            {
+                int size = std::stoi(batchSize.c_str());
+                if (size < 1)
+                {
+                    throw hresult_invalid_argument(L"-BatchSize sizes must be at least 1!");
+                }
+                m_batchSizes.push_back(static_cast<uint32_t>(size));
+            }
+            if (m_batchSizes.empty())
+            {
+                throw hresult_invalid_argument(L"-BatchSize requires at least one batch size!");
+            }
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-OpenLoop") == 0))
+        {
+            CheckNextArgument(args, i);
+            double rate = std::stod(args[++i].c_str());
+            if (rate <= 0)
+            {
+                throw hresult_invalid_argument(L"-OpenLoop rate must be greater than 0!");
+            }
+            ArrivalProcess arrivalProcess = ArrivalProcess::Constant;
+            if (i + 1 < args.size() && args[i + 1][0] != L'-')
+            {
+                if (_wcsicmp(args[++i].c_str(), L"Constant") == 0)
+                {
+                    arrivalProcess = ArrivalProcess::Constant;
+                }
+                else if (_wcsicmp(args[i].c_str(), L"Poisson") == 0)
+                {
+                    arrivalProcess = ArrivalProcess::Poisson;
+                }
+                else
+                {
+                    PrintUsage();
+                    throw hresult_invalid_argument(L"Unknown OpenLoop arrival process!");
+                }
+            }
+            SetOpenLoop(rate, arrivalProcess);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-MaxQueueDepth") == 0))
+        {
+            CheckNextArgument(args, i);
+            uint32_t depth = std::stoul(args[++i].c_str());
+            if (depth == 0)
+            {
+                throw hresult_invalid_argument(L"-MaxQueueDepth must be greater than 0!");
+            }
+            QueueFullPolicy policy = QueueFullPolicy::Block;
+            if (i + 1 < args.size() && args[i + 1][0] != L'-')
+            {
+                if (_wcsicmp(args[++i].c_str(), L"Block") == 0)
+                {
+                    policy = QueueFullPolicy::Block;
+                }
+                else if (_wcsicmp(args[i].c_str(), L"Reject") == 0)
+                {
+                    policy = QueueFullPolicy::Reject;
+                }
+                else if (_wcsicmp(args[i].c_str(), L"DropOldest") == 0)
+                {
+                    policy = QueueFullPolicy::DropOldest;
+                }
+                else
+                {
+                    PrintUsage();
+                    throw hresult_invalid_argument(L"Unknown MaxQueueDepth policy!");
+                }
+            }
+            SetMaxQueueDepth(depth, policy);
+        }
+        else if ((_wcsicmp(args[i].c_str(), L"-CacheInputFeatures") == 0))
+        {
+            ToggleCacheInputFeatures(true);
+            if (i + 1 < args.size() && args[i + 1][0] != L'-')
+            {
+                SetGarbageInputVariants(std::stoul(args[++i].c_str()));
+                if (m_garbageInputVariants == 0)
+                {
+                    throw hresult_invalid_argument(L"-CacheInputFeatures needs at least one garbage input variant!");
+                }
+            }
+        }
         else if ((_wcsicmp(args[i].c_str(), L"-WaitForDebugger") == 0))
         {
             while (!IsDebuggerPresent())
@@ -401,7 +740,7 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
         }
     }
 
-    if (m_modelPath.empty() && m_modelFolderPath.empty())
+    if (m_modelPath.empty() && m_modelFolderPath.empty() && !IsThreadPoolBenchmark())
     {
         std::cout << std::endl;
         PrintUsage();
@@ -431,6 +770,11 @@ CommandLineArgs::CommandLineArgs(const std::vector<std::wstring>& args)
     {
         PopulateInputImagePaths();
     }
+    if (IsAdaptiveIterations() && !isIterationsSpecified)
+    {
+        // Enough for the confidence interval of most models to converge well before the budget runs out
+        m_numIterations = 1024;
+    }
     SetupOutputDirectories(sBaseOutputPath, sPerfOutputPath, sPerIterationDataPath);
 
     CheckForInvalidArguments();
@@ -536,6 +880,59 @@ void CommandLineArgs::CheckForInvalidArguments()
     {
         throw hresult_not_implemented(L"Saving tensor output for multiple images isn't implemented.");
     }
+    if ((IsAsyncEvaluation() + IsPipelined() + IsOpenLoop()) > 1)
+    {
+        throw hresult_invalid_argument(L"Only one of -AsyncDepth, -Pipeline and -OpenLoop can be used at a time!");
+    }
+    if (IsSweep() && (IsConcurrentLoad() || IsPerIterationCapture() || IsSaveTensor()))
+    {
+        throw hresult_invalid_argument(
+            L"-SweepWorkers cannot be used with -ConcurrentLoad, -SavePerIterationPerf or -SaveTensorData!");
+    }
+    if (IsPrefetchingSessions() && !IsPrefetchingModels())
+    {
+        throw hresult_invalid_argument(L"-PrefetchSessions requires -PrefetchModels!");
+    }
+    if (IsBindingOutputs() && (IsAsyncEvaluation() || IsOpenLoop() || IsThroughputMode()))
+    {
+        throw hresult_invalid_argument(L"-BindOutputs cannot be used with -AsyncDepth, -OpenLoop or -Throughput!");
+    }
+    if (MaxThreads() > 0 && !IsOpenLoop() && !IsPrefetchingModels())
+    {
+        throw hresult_invalid_argument(L"-MaxThreads requires -OpenLoop or -PrefetchModels!");
+    }
+    if (IsOpenLoop() && MaxThreads() > 0 && MaxThreads() < NumThreads())
+    {
+        throw hresult_invalid_argument(L"-MaxThreads cannot be less than -NumThreads!");
+    }
+    if (IsThreadPoolStats() && !IsOpenLoop())
+    {
+        throw hresult_invalid_argument(L"-ThreadPoolStats requires -OpenLoop!");
+    }
+    if (IsBoundedQueue() && !IsOpenLoop() && !IsThreadPoolBenchmark())
+    {
+        throw hresult_invalid_argument(L"-MaxQueueDepth requires -OpenLoop or -ThreadPoolBenchmark!");
+    }
+    if (WorkerThreadPlacement() != ThreadPlacement::None && !IsOpenLoop() && !IsThroughputMode() &&
+        !IsConcurrentLoad() && !IsThreadPoolBenchmark())
+    {
+        throw hresult_invalid_argument(
+            L"-ThreadPlacement requires -OpenLoop, -Throughput, -ConcurrentLoad or -ThreadPoolBenchmark!");
+    }
+    if (IsPerfTimingOnly() && !IsPerformanceCapture() && !IsPerIterationCapture())
+    {
+        throw hresult_invalid_argument(L"-PerfTimingOnly requires -Perf or -SavePerIterationPerf!");
+    }
+    if (IsAdaptiveIterations() && !IsPerformanceCapture())
+    {
+        throw hresult_invalid_argument(L"-AdaptiveIterations requires -Perf!");
+    }
+    // The warm up resets the bind statistics on the main thread, which a -Pipeline bind worker may be updating
+    if (IsAdaptiveIterations() && (IsAsyncEvaluation() || IsPipelined() || IsOpenLoop() || IsThroughputMode()))
+    {
+        throw hresult_invalid_argument(
+            L"-AdaptiveIterations cannot be used with -AsyncDepth, -Pipeline, -OpenLoop or -Throughput!");
+    }
 }
 
 std::vector<InputDataType> CommandLineArgs::FetchInputDataTypes()
@@ -2,6 +2,7 @@
 #include "Common.h"
 #include <winrt/Windows.Graphics.Imaging.h>
 #include "TypeHelper.h"
+#include "ThreadPool.h"
 enum TensorizeFuncs
 {
     Identity = 0,
@@ -35,6 +36,7 @@ public:
     bool IsUsingGPUBoundInput() const { return m_useGPUBoundInput; }
     bool IsPerformanceCapture() const { return m_perfCapture; }
     bool IsPerformanceConsoleOutputVerbose() const { return m_perfConsoleOutputAll; }
+    bool IsPerfTimingOnly() const { return m_perfTimingOnly; }
     bool IsEvaluationDebugOutputEnabled() const { return m_evaluation_debug_output; }
     bool TerseOutput() const { return m_terseOutput; }
     bool IsPerIterationCapture() const { return m_perIterCapture; }
@@ -43,6 +45,21 @@ public:
     bool IsOutputPerf() const { return m_perfOutput; }
     bool IsSaveTensor() const { return m_saveTensor; }
     bool IsTimeLimitIterations() const { return m_timeLimitIterations; }
+    bool IsPipelined() const { return m_pipelineDepth > 1; }
+    bool IsCachingInputFeatures() const { return m_cacheInputFeatures; }
+    bool IsThroughputMode() const { return m_throughputSessions > 0; }
+    bool IsSweep() const { return m_sweepWorkers > 0; }
+    bool IsThreadPoolBenchmark() const { return m_threadPoolBenchmarkTasks > 0; }
+    bool IsPrefetchingModels() const { return m_prefetchModels > 0; }
+    bool IsPrefetchingSessions() const { return m_prefetchSessions; }
+    // More than one session creation iteration always creates a new session per iteration
+    bool IsRecreatingSession() const { return m_recreateSession || m_numSessionIterations > 1; }
+    bool IsBindingOutputs() const { return m_bindOutputs; }
+    bool IsAsyncEvaluation() const { return m_asyncDepth > 0; }
+    bool IsOpenLoop() const { return m_openLoopRate > 0; }
+    bool IsBoundedQueue() const { return m_maxQueueDepth > 0; }
+    bool IsBatchSizeSweep() const { return !m_batchSizes.empty(); }
+    bool IsAdaptiveIterations() const { return m_adaptiveIterations; }
     BitmapInterpolationMode AutoScaleInterpMode() const { return m_autoScaleInterpMode; }
 
     const std::vector<std::wstring>& ImagePaths() const { return m_imagePaths; }
@@ -106,7 +123,32 @@ public:
     uint32_t NumLoadIterations() const { return m_numLoadIterations; }
     uint32_t NumSessionCreationIterations() const { return m_numSessionIterations; }
     double IterationTimeLimit() const { return m_iterationTimeLimitMilliseconds; }
+    uint32_t PipelineDepth() const { return m_pipelineDepth; }
+    uint32_t GarbageInputVariants() const { return m_garbageInputVariants; }
+    uint32_t ThroughputSessions() const { return m_throughputSessions; }
+    uint32_t SweepWorkers() const { return m_sweepWorkers; }
+    uint32_t PrefetchModels() const { return m_prefetchModels; }
+    uint32_t PrefetchMemoryLimit() const { return m_prefetchMemoryLimitMB; } // in MB, 0 for no limit
+    uint32_t JobTimeout() const { return m_jobTimeoutSeconds; }
+    uint32_t ThreadPoolBenchmarkTasks() const { return m_threadPoolBenchmarkTasks; }
+    // Arguments the runner was started with
+    const std::vector<std::wstring>& Arguments() const { return m_arguments; }
+    uint32_t AsyncDepth() const { return m_asyncDepth; }
+    double OpenLoopRate() const { return m_openLoopRate; } // Requests per second
+    ArrivalProcess OpenLoopArrivalProcess() const { return m_openLoopArrivalProcess; }
+    uint32_t MaxQueueDepth() const { return m_maxQueueDepth; } // 0 for an unbounded queue
+    QueueFullPolicy MaxQueueDepthPolicy() const { return m_queueFullPolicy; }
+    ThreadPlacement WorkerThreadPlacement() const { return m_threadPlacement; }
+    const std::vector<uint32_t>& BatchSizes() const { return m_batchSizes; }
+    // Batch size of the configuration that is currently being run
+    uint32_t BatchSize() const { return m_batchSize; }
+    AdaptiveStatistic AdaptiveIterationsStatistic() const { return m_adaptiveStatistic; }
+    double WarmupCV() const { return m_warmupCV; }
+    double TargetRelativeError() const { return m_targetRelativeError; }
+    uint32_t ThroughputThreadsPerSession() const { return m_throughputThreadsPerSession; }
     uint32_t NumThreads() const { return m_numThreads; }
+    uint32_t MaxThreads() const { return m_maxThreads; } // 0 when pools don't grow
+    bool IsThreadPoolStats() const { return m_threadPoolStats; }
     uint32_t ThreadInterval() const { return m_threadInterval; } // Thread interval in milliseconds
     uint32_t TopK() const { return m_topK; }
     uint32_t GarbageDataMaxValue() const { return m_garbageDataMaxValue; }
@@ -125,11 +167,13 @@ public:
     void ToggleUseBGR(bool useBGRImage) { m_useBGR = useBGRImage; }
     void ToggleUseTensor(bool useTensor) { m_useTensor = useTensor; }
     void TogglePerformanceCapture(bool perfCapture) { m_perfCapture = perfCapture; }
+    void TogglePerfTimingOnly(bool perfTimingOnly) { m_perfTimingOnly = perfTimingOnly; }
     void ToggleIgnoreFirstRun(bool ignoreFirstRun) { m_ignoreFirstRun = ignoreFirstRun; }
     void TogglePerIterationPerformanceCapture(bool perIterCapture) { m_perIterCapture = perIterCapture; }
     void ToggleEvaluationDebugOutput(bool debug) { m_evaluation_debug_output = debug; }
     void ToggleTerseOutput(bool terseOutput) { m_terseOutput = terseOutput; }
     void TogglePerfOutput(bool perfOutput) { m_perfOutput = perfOutput; }
+    void ToggleCacheInputFeatures(bool cacheInputFeatures) { m_cacheInputFeatures = cacheInputFeatures; }
 
     void SetModelPath(const std::wstring& modelPath) { m_modelPath = modelPath; }
     void SetPerIterationDataPath(const std::wstring& perIterationDataPath)
@@ -138,6 +182,8 @@ public:
     }
     void SetInputDataPath(const std::wstring& inputDataPath) { m_inputData = inputDataPath; }
     void SetNumThreads(unsigned numThreads) { m_numThreads = numThreads; }
+    void SetMaxThreads(unsigned maxThreads) { m_maxThreads = maxThreads; }
+    void ToggleThreadPoolStats(bool threadPoolStats) { m_threadPoolStats = threadPoolStats; }
     void SetThreadInterval(unsigned threadInterval) { m_threadInterval = threadInterval; }
     void SetTopK(unsigned k) { m_topK = k; }
     void SetPerformanceCSVPath(const std::wstring& performanceCSVPath) { m_perfOutputPath = performanceCSVPath; }
@@ -148,6 +194,41 @@ public:
     void AddProvidedInputFeatureValue(const ILearningModelFeatureValue& input);
     void ClearProvidedInputFeatureValues() { m_providedInputFeatureValues.clear(); };
     void SetGarbageDataMaxValue(const uint32_t value) { m_garbageDataMaxValue = value; }
+    void SetPipelineDepth(const uint32_t depth) { m_pipelineDepth = depth; }
+    void SetGarbageInputVariants(const uint32_t variants) { m_garbageInputVariants = variants; }
+    void SetAsyncDepth(const uint32_t depth) { m_asyncDepth = depth; }
+    void SetBatchSize(const uint32_t batchSize) { m_batchSize = batchSize; }
+    void SetSweepWorkers(const uint32_t workers) { m_sweepWorkers = workers; }
+    void SetPrefetchModels(const uint32_t numModels) { m_prefetchModels = numModels; }
+    void SetPrefetchMemoryLimit(const uint32_t megabytes) { m_prefetchMemoryLimitMB = megabytes; }
+    void TogglePrefetchSessions(bool prefetchSessions) { m_prefetchSessions = prefetchSessions; }
+    void ToggleRecreateSession(bool recreateSession) { m_recreateSession = recreateSession; }
+    void ToggleBindOutputs(bool bindOutputs) { m_bindOutputs = bindOutputs; }
+    void SetJobTimeout(const uint32_t seconds) { m_jobTimeoutSeconds = seconds; }
+    void SetThreadPoolBenchmarkTasks(const uint32_t tasks) { m_threadPoolBenchmarkTasks = tasks; }
+    void SetAdaptiveIterations(const AdaptiveStatistic statistic)
+    {
+        m_adaptiveIterations = true;
+        m_adaptiveStatistic = statistic;
+    }
+    void SetWarmupCV(const double warmupCV) { m_warmupCV = warmupCV; }
+    void SetTargetRelativeError(const double targetRelativeError) { m_targetRelativeError = targetRelativeError; }
+    void SetOpenLoop(const double rate, const ArrivalProcess arrivalProcess)
+    {
+        m_openLoopRate = rate;
+        m_openLoopArrivalProcess = arrivalProcess;
+    }
+    void SetMaxQueueDepth(const uint32_t depth, const QueueFullPolicy policy)
+    {
+        m_maxQueueDepth = depth;
+        m_queueFullPolicy = policy;
+    }
+    void SetThreadPlacement(const ThreadPlacement placement) { m_threadPlacement = placement; }
+    void SetThroughput(const uint32_t sessions, const uint32_t threadsPerSession)
+    {
+        m_throughputSessions = sessions;
+        m_throughputThreadsPerSession = threadsPerSession;
+    }
 
     // Stop iterating when total time of iterations after the first iteration exceeds time limit.
     void SetIterationTimeLimit(const double milliseconds)
@@ -165,6 +246,7 @@ public:
 private:
     bool m_perfCapture = false;
     bool m_perfConsoleOutputAll = false;
+    bool m_perfTimingOnly = false;
     bool m_useCPU = false;
     bool m_useGPU = false;
     bool m_useGPUHighPerformance = false;
@@ -186,6 +268,7 @@ private:
     BitmapInterpolationMode m_autoScaleInterpMode = BitmapInterpolationMode::Cubic;
     bool m_saveTensor = false;
     bool m_timeLimitIterations = false;
+    bool m_cacheInputFeatures = false;
     std::wstring m_saveTensorMode = L"First";
     ::TensorizeArgs m_tensorizeArgs;
 
@@ -205,7 +288,34 @@ private:
     uint32_t m_numLoadIterations = 1;
     uint32_t m_numSessionIterations = 1;
     double m_iterationTimeLimitMilliseconds = 0;
+    uint32_t m_pipelineDepth = 0;
+    uint32_t m_garbageInputVariants = 4;
+    uint32_t m_asyncDepth = 0;
+    double m_openLoopRate = 0;
+    ArrivalProcess m_openLoopArrivalProcess = ArrivalProcess::Constant;
+    uint32_t m_maxQueueDepth = 0;
+    QueueFullPolicy m_queueFullPolicy = QueueFullPolicy::Block;
+    ThreadPlacement m_threadPlacement = ThreadPlacement::None;
+    std::vector<uint32_t> m_batchSizes;
+    uint32_t m_batchSize = 1;
+    bool m_adaptiveIterations = false;
+    AdaptiveStatistic m_adaptiveStatistic = AdaptiveStatistic::Mean;
+    double m_warmupCV = 0.05;
+    double m_targetRelativeError = 0.02;
+    uint32_t m_throughputSessions = 0;
+    uint32_t m_sweepWorkers = 0;
+    uint32_t m_prefetchModels = 0;
+    uint32_t m_prefetchMemoryLimitMB = 2048;
+    bool m_prefetchSessions = false;
+    bool m_recreateSession = false;
+    bool m_bindOutputs = false;
+    uint32_t m_jobTimeoutSeconds = 0;
+    uint32_t m_threadPoolBenchmarkTasks = 0;
+    std::vector<std::wstring> m_arguments;
+    uint32_t m_throughputThreadsPerSession = 1;
     uint32_t m_numThreads = 1;
+    uint32_t m_maxThreads = 0;
+    bool m_threadPoolStats = false;
     uint32_t m_threadInterval = 0;
     uint32_t m_topK = 1;
     uint32_t m_garbageDataMaxValue = 0;
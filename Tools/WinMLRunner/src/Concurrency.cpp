@@ -1,10 +1,15 @@
 #include <iostream>
+#include <fstream>
+#include <filesystem>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <regex>
 
 #include "Windows.h"
 #include "common.h"
 #include "ThreadPool.h"
+#include "Scenarios.h"
 
 using namespace winrt;
 #ifdef USE_WINML_NUGET
@@ -13,7 +18,7 @@ using namespace winrt::Microsoft::AI::MachineLearning;
 using namespace winrt::Windows::AI::MachineLearning;
 #endif
 
-void load_model(const std::wstring& path, bool print_info)
+double load_model(const std::wstring& path, bool print_info)
 {
     if (print_info)
     {
@@ -21,28 +26,247 @@ void load_model(const std::wstring& path, bool print_info)
         ss << L"Begin loading a model " << path << L" in thread " << std::this_thread::get_id() << std::endl;
         std::wcout << ss.str();
     }
+    Timer timer;
+    timer.Start();
     auto model = LearningModel::LoadFromFilePath(path);
+    double latency = timer.Stop();
+    model.Close();
     if (print_info)
     {
         std::wstringstream ss;
-        ss << L"End loading a model in thread " << std::this_thread::get_id() << std::endl;
+        ss << L"End loading a model in thread " << std::this_thread::get_id() << L" (" << latency << L" ms)"
+           << std::endl;
         std::wcout << ss.str();
     }
+    return latency;
 }
 
-void ConcurrentLoadModel(const std::vector<std::wstring>& paths, unsigned num_threads, unsigned interval_milliseconds,
-                         bool print_info)
+std::vector<unsigned> GetScalingThreadCounts(unsigned max_threads)
 {
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back((std::max)(max_threads, 1u));
+    return thread_counts;
+}
+
+std::vector<ConcurrencyScalingPoint> ConcurrentLoadModel(const std::vector<std::wstring>& paths, unsigned num_threads,
+                                                         unsigned interval_milliseconds, bool print_info,
+                                                         ThreadPlacement placement)
+{
+    // Creating enough loads for every thread to load a model
+    // If there are more threads than models, some threads will concurrently load same models
+    size_t num_loads = paths.size() > num_threads ? paths.size() : num_threads;
+    std::vector<ConcurrencyScalingPoint> points;
+    // The loads of one thread and how long it was loading, which doesn't include its stagger
+    struct ThreadLoads
+    {
+        double LoadingTime = 0;
+        LatencySummary Latencies;
+    };
+    for (unsigned threads : GetScalingThreadCounts(num_threads))
+    {
+        std::atomic<size_t> next_load = 0;
+        std::vector<std::future<ThreadLoads>> thread_loads;
+        // Declared after the counter and the futures so that the threads are joined before those are destroyed.
+        ThreadPool pool(threads, 0, QueueFullPolicy::Block, placement);
+        for (unsigned thread = 0; thread < threads; thread++)
+        {
+            thread_loads.push_back(pool.SubmitWork([&, thread]() {
+                Sleep(thread * interval_milliseconds);
+                ThreadLoads loads;
+                Timer loading_timer;
+                loading_timer.Start();
+                for (size_t load = next_load++; load < num_loads; load = next_load++)
+                {
+                    loads.Latencies.Record(load_model(paths[load % paths.size()], print_info));
+                }
+                loads.LoadingTime = loading_timer.Stop();
+                return loads;
+            }));
+        }
+
+        ConcurrencyScalingPoint point;
+        point.Phase = L"load";
+        point.NumThreads = threads;
+        for (auto& future : thread_loads)
+        {
+            ThreadLoads loads = future.get();
+            // The wall time is that of the thread that loaded longest, so staggering the threads doesn't count
+            point.WallTime = (std::max)(point.WallTime, loads.LoadingTime);
+            point.Latency.Merge(loads.Latencies);
+            point.ThreadLatencies.push_back(std::move(loads.Latencies));
+        }
+        points.push_back(point);
+    }
+    return points;
+}
+
+// A small unit of work, like processing one tile of an image in the worker's scratch memory
+static void RunTile()
+{
+    uint32_t* tile = static_cast<uint32_t*>(GetThreadScratch(256 * sizeof(uint32_t)));
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        tile[i] = tile[i] + i * i;
+    }
+}
+
+template <typename Pool, typename... PoolArgs>
+static ConcurrencyScalingPoint BenchmarkThreadPool(const std::wstring& name, unsigned threads, unsigned num_tasks,
+                                                   bool use_post, PoolArgs... pool_args)
+{
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> latencies(num_tasks);
+    std::atomic<unsigned> completed_tasks = 0;
+    // Declared after the latencies and the counter so that the workers are joined before those are destroyed.
+    Pool pool(threads, pool_args...);
+    size_t task_allocations = Task::HeapAllocations() + TaskQueue::Reallocations();
+    Timer wall_timer;
+    wall_timer.Start();
+    std::vector<std::thread> producers;
+    for (unsigned producer = 0; producer < threads; producer++)
+    {
+        producers.emplace_back([&, producer]() {
+            std::vector<std::future<void>> futures;
+            for (unsigned task = producer; task < num_tasks; task += threads)
+            {
+                auto submitted = Clock::now();
+                auto work = [&latencies, &completed_tasks, task, submitted]() {
+                    latencies[task] = std::chrono::duration<double, std::milli>(Clock::now() - submitted).count();
+                    RunTile();
+                    completed_tasks++;
+                };
+                if (use_post)
+                {
+                    pool.Post(work);
+                }
+                else
+                {
+                    futures.push_back(pool.SubmitWork(work));
+                }
+            }
+            for (auto& future : futures)
+            {
+                future.get();
+            }
+        });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    while (completed_tasks < num_tasks)
+    {
+        std::this_thread::yield();
+    }
 
-    ThreadPool pool(num_threads);
-    // Creating enough threads to load all the models specified
-    // If there is more than enough threads, some threads will concurrently load same models
-    size_t threads_size = paths.size() > num_threads ? paths.size() : num_threads;
-    std::vector<std::future<void>> output_futures;
-    for (size_t i = 0; i < threads_size; i++)
+    ConcurrencyScalingPoint point;
+    point.WallTime = wall_timer.Stop();
+    task_allocations = Task::HeapAllocations() + TaskQueue::Reallocations() - task_allocations;
+    point.Phase = name;
+    point.NumThreads = threads;
+    for (unsigned producer = 0; producer < threads; producer++)
     {
-        Sleep(interval_milliseconds);
-        output_futures.push_back(pool.SubmitWork(load_model, std::ref(paths[i % paths.size()]), true));
+        LatencySummary producer_latencies;
+        for (unsigned task = producer; task < num_tasks; task += threads)
+        {
+            producer_latencies.Record(latencies[task]);
+        }
+        point.Latency.Merge(producer_latencies);
+        point.ThreadLatencies.push_back(std::move(producer_latencies));
+    }
+    // Futures add the allocation of their shared state on top of these
+    std::wcout << name << L", " << threads << L" threads: "
+               << static_cast<double>(task_allocations) / (std::max)(num_tasks, 1u)
+               << L" task and queue allocations per task" << std::endl;
+    return point;
+}
+
+void RunThreadPoolBenchmark(unsigned max_threads, unsigned num_tasks, size_t max_queue_depth,
+                            ThreadPlacement placement, const std::wstring& csv_path)
+{
+    std::vector<ConcurrencyScalingPoint> points;
+    for (unsigned threads : GetScalingThreadCounts(max_threads))
+    {
+        points.push_back(BenchmarkThreadPool<ThreadPool>(L"mutex thread pool", threads, num_tasks, false, size_t(0),
+                                                         QueueFullPolicy::Block, placement));
+        points.push_back(BenchmarkThreadPool<ThreadPool>(L"mutex thread pool post", threads, num_tasks, true,
+                                                         size_t(0), QueueFullPolicy::Block, placement));
+        points.push_back(BenchmarkThreadPool<ThreadPool>(L"bounded queue thread pool post", threads, num_tasks, true,
+                                                         max_queue_depth, QueueFullPolicy::Block, placement));
+        points.push_back(BenchmarkThreadPool<WorkStealingThreadPool>(L"work-stealing thread pool", threads, num_tasks,
+                                                                     false, placement));
+        points.push_back(BenchmarkThreadPool<WorkStealingThreadPool>(L"work-stealing thread pool post", threads,
+                                                                     num_tasks, true, placement));
+    }
+    WriteConcurrencyScaling(points, csv_path);
+}
+
+std::wstring GetScalingCsvPath(const std::wstring& perf_csv_path)
+{
+    if (perf_csv_path.empty())
+    {
+        return perf_csv_path;
+    }
+    std::filesystem::path path(perf_csv_path);
+    std::wstring extension = path.has_extension() ? path.extension().wstring() : L".csv";
+    return path.replace_filename(path.stem().wstring() + L"_scaling" + extension).wstring();
+}
+
+void WriteConcurrencyScaling(const std::vector<ConcurrencyScalingPoint>& points, const std::wstring& csv_path)
+{
+    std::wofstream fout;
+    if (!csv_path.empty())
+    {
+        bool is_new_file = !std::filesystem::exists(csv_path);
+        fout.open(csv_path, std::ios::app);
+        if (is_new_file)
+        {
+            fout << L"phase,model,device,threads,operations,wall time (ms),operations/sec,average latency (ms),"
+                    L"p50 latency (ms),p99 latency (ms),max latency (ms),slowest thread average latency (ms),"
+                    L"scaling efficiency,contention ratio"
+                 << std::endl;
+        }
+    }
+
+    std::wcout << std::endl << L"Concurrency scaling:" << std::endl;
+    for (const auto& point : points)
+    {
+        auto baseline = std::find_if(points.begin(), points.end(), [&](const ConcurrencyScalingPoint& other) {
+            return other.NumThreads == 1 && other.Phase == point.Phase && other.ModelPath == point.ModelPath &&
+                   other.Device == point.Device;
+        });
+        // Scaling efficiency is the fraction of the single thread rate that each thread keeps, contention ratio how
+        // much longer each operation takes than when it runs alone.
+        double scaling_efficiency = 0;
+        double contention_ratio = 0;
+        if (baseline != points.end() && baseline->OperationsPerSecond() > 0 && baseline->Latency.GetAverage() > 0)
+        {
+            scaling_efficiency = point.OperationsPerSecond() / (baseline->OperationsPerSecond() * point.NumThreads);
+            contention_ratio = point.Latency.GetAverage() / baseline->Latency.GetAverage();
+        }
+        double slowest_thread_latency = 0;
+        for (const auto& thread_latency : point.ThreadLatencies)
+        {
+            slowest_thread_latency = (std::max)(slowest_thread_latency, thread_latency.GetAverage());
+        }
+
+        std::wcout << L"  " << point.Phase << (point.ModelPath.empty() ? L"" : L" " + point.ModelPath)
+                   << (point.Device.empty() ? L"" : L" " + point.Device) << L", " << point.NumThreads
+                   << L" threads: " << point.OperationsPerSecond() << L" operations/sec, average latency "
+                   << point.Latency.GetAverage() << L" ms, p99 " << point.Latency.GetPercentile(99)
+                   << L" ms, scaling efficiency " << scaling_efficiency * 100 << L" %, contention ratio "
+                   << contention_ratio << std::endl;
+        if (fout.is_open())
+        {
+            fout << point.Phase << L"," << point.ModelPath << L"," << point.Device << L"," << point.NumThreads << L","
+                 << point.Latency.GetCount() << L"," << point.WallTime << L"," << point.OperationsPerSecond() << L","
+                 << point.Latency.GetAverage() << L"," << point.Latency.GetPercentile(50) << L","
+                 << point.Latency.GetPercentile(99) << L"," << point.Latency.GetMax() << L","
+                 << slowest_thread_latency << L"," << scaling_efficiency << L"," << contention_ratio << std::endl;
+        }
     }
-    // TODO: read output values from load_model
 }
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+// A high dynamic range histogram of non-negative values. Values are rounded to a multiple of the resolution and
+// counted in buckets that are exact below 128 units and then 64 per power of two, so every bucket is narrower than
+// 1/64 of its values. Percentiles of values above 128 units are within 1% whatever their magnitude, memory grows with
+// the logarithm of the largest value instead of the number of values, and histograms of the same resolution merge
+// exactly. The count, total, minimum and maximum are exact.
+class Histogram
+{
+public:
+    explicit Histogram(double resolution = 1) : m_resolution(resolution) { Reset(); }
+
+    void Reset()
+    {
+        m_buckets.clear();
+        m_count = 0;
+        m_total = 0;
+        m_totalOfSquares = 0;
+        m_min = DBL_MAX;
+        m_max = 0;
+    }
+
+    void Record(double value, uint64_t count = 1)
+    {
+        value = (std::max)(value, 0.0);
+        size_t index = GetIndex(static_cast<uint64_t>((std::min)(std::round(value / m_resolution), MaxUnits)));
+        if (index >= m_buckets.size())
+        {
+            m_buckets.resize(index + 1, 0);
+        }
+        m_buckets[index] += count;
+        m_count += count;
+        m_total += value * count;
+        m_totalOfSquares += value * value * count;
+        m_min = (std::min)(m_min, value);
+        m_max = (std::max)(m_max, value);
+    }
+
+    // other must have the same resolution
+    void Merge(const Histogram& other)
+    {
+        if (other.m_buckets.size() > m_buckets.size())
+        {
+            m_buckets.resize(other.m_buckets.size(), 0);
+        }
+        for (size_t index = 0; index < other.m_buckets.size(); index++)
+        {
+            m_buckets[index] += other.m_buckets[index];
+        }
+        m_count += other.m_count;
+        m_total += other.m_total;
+        m_totalOfSquares += other.m_totalOfSquares;
+        m_min = (std::min)(m_min, other.m_min);
+        m_max = (std::max)(m_max, other.m_max);
+    }
+
+    uint64_t GetCount() const { return m_count; }
+    double GetTotal() const { return m_total; }
+    double GetAverage() const { return m_count > 0 ? m_total / m_count : 0; }
+    double GetMin() const { return m_count > 0 ? m_min : 0; }
+    double GetMax() const { return m_max; }
+    double GetStdev() const
+    {
+        if (m_count == 0)
+            return 0;
+
+        double average = GetAverage();
+        return sqrt((std::max)(m_totalOfSquares / m_count - average * average, 0.0));
+    }
+
+    // Nearest-rank percentile, percentile is in [0, 100]. Returns the middle of the bucket holding that rank.
+    double GetPercentile(double percentile) const
+    {
+        if (m_count == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100.0 * m_count));
+        rank = (std::max)(rank, static_cast<uint64_t>(1));
+        if (rank >= m_count)
+        {
+            return m_max;
+        }
+        uint64_t seen = 0;
+        for (size_t index = 0; index < m_buckets.size(); index++)
+        {
+            seen += m_buckets[index];
+            if (seen >= rank)
+            {
+                return GetMiddle(index);
+            }
+        }
+        return m_max;
+    }
+
+    // Average of the values left after discarding the fraction of lowest and the fraction of highest values, e.g. 0.1
+    // for the 10% trimmed mean. Less sensitive to outliers than the average.
+    double GetTrimmedMean(double fraction) const
+    {
+        double low = fraction * m_count;
+        double high = m_count - low;
+        if (high <= low)
+            return GetPercentile(50);
+
+        // Counts the part of every bucket that falls between the low and high ranks, at the middle of the bucket
+        double total = 0;
+        double seen = 0;
+        for (size_t index = 0; index < m_buckets.size(); index++)
+        {
+            double next = seen + m_buckets[index];
+            double kept = (std::min)(next, high) - (std::max)(seen, low);
+            if (kept > 0)
+            {
+                total += kept * GetMiddle(index);
+            }
+            seen = next;
+        }
+        return total / (high - low);
+    }
+
+    // Median of the distances of the values from their median, a spread that outliers barely move
+    double GetMedianAbsoluteDeviation() const
+    {
+        if (m_count == 0)
+            return 0;
+
+        double median = GetPercentile(50);
+        std::vector<std::pair<double, uint64_t>> deviations;
+        for (size_t index = 0; index < m_buckets.size(); index++)
+        {
+            if (m_buckets[index] > 0)
+            {
+                deviations.push_back({ std::abs(GetMiddle(index) - median), m_buckets[index] });
+            }
+        }
+        std::sort(deviations.begin(), deviations.end());
+        uint64_t rank = (m_count + 1) / 2;
+        uint64_t seen = 0;
+        for (const auto& deviation : deviations)
+        {
+            seen += deviation.second;
+            if (seen >= rank)
+            {
+                return deviation.first;
+            }
+        }
+        return 0;
+    }
+
+    // Percentile bootstrap confidence interval of the average, e.g. 0.95 for the 95% interval. Every resample draws
+    // as many values as were recorded, which only takes a binomial draw per bucket. The seed is fixed so that the
+    // same histogram always gives the same interval.
+    std::pair<double, double> GetAverageConfidenceInterval(double confidence, size_t resamples = 1000) const
+    {
+        if (m_count < 2)
+            return { GetAverage(), GetAverage() };
+
+        std::vector<size_t> buckets;
+        double bucketedTotal = 0;
+        for (size_t index = 0; index < m_buckets.size(); index++)
+        {
+            if (m_buckets[index] > 0)
+            {
+                buckets.push_back(index);
+                bucketedTotal += m_buckets[index] * GetMiddle(index);
+            }
+        }
+        std::mt19937_64 generator(0);
+        std::vector<double> averages(resamples);
+        for (double& average : averages)
+        {
+            // Draws the number of values of each bucket from the ones not drawn yet
+            uint64_t remaining = m_count;
+            uint64_t remainingInBuckets = m_count;
+            double total = 0;
+            for (size_t index : buckets)
+            {
+                if (remaining == 0)
+                    break;
+
+                uint64_t drawn = remaining;
+                if (m_buckets[index] < remainingInBuckets)
+                {
+                    std::binomial_distribution<uint64_t> draw(
+                        remaining, static_cast<double>(m_buckets[index]) / remainingInBuckets);
+                    drawn = draw(generator);
+                }
+                total += drawn * GetMiddle(index);
+                remaining -= drawn;
+                remainingInBuckets -= m_buckets[index];
+            }
+            average = total / m_count;
+        }
+        std::sort(averages.begin(), averages.end());
+        // The buckets' middles are shifted back onto the exact average
+        double shift = GetAverage() - bucketedTotal / m_count;
+        size_t lower = static_cast<size_t>((1 - confidence) / 2 * (resamples - 1));
+        size_t upper = resamples - 1 - lower;
+        return { averages[lower] + shift, averages[upper] + shift };
+    }
+
+private:
+    static constexpr unsigned SubBucketBits = 7;
+    static constexpr uint64_t SubBucketCount = 1ull << SubBucketBits;
+    static constexpr uint64_t SubBucketHalfCount = SubBucketCount / 2;
+    // Larger values are counted in the last bucket, their exact maximum is still kept
+    static constexpr double MaxUnits = 4611686018427387904.0; // 2^62
+
+    static unsigned GetHighestBit(uint64_t units)
+    {
+        unsigned bit = 0;
+        for (unsigned step = 32; step > 0; step /= 2)
+        {
+            if (units >> (bit + step))
+            {
+                bit += step;
+            }
+        }
+        return bit;
+    }
+
+    static size_t GetIndex(uint64_t units)
+    {
+        if (units < SubBucketCount)
+        {
+            return static_cast<size_t>(units);
+        }
+        // Keeps the 7 highest bits of units, whose highest bit is always set
+        unsigned shift = GetHighestBit(units) - (SubBucketBits - 1);
+        return static_cast<size_t>(SubBucketCount + (shift - 1) * SubBucketHalfCount +
+                                   ((units >> shift) - SubBucketHalfCount));
+    }
+
+    static uint64_t GetLowerBound(size_t index)
+    {
+        if (index < SubBucketCount)
+        {
+            return index;
+        }
+        unsigned shift = static_cast<unsigned>((index - SubBucketCount) / SubBucketHalfCount) + 1;
+        return (SubBucketHalfCount + (index - SubBucketCount) % SubBucketHalfCount) << shift;
+    }
+
+    static uint64_t GetWidth(size_t index)
+    {
+        return index < SubBucketCount ? 1 : 1ull << (((index - SubBucketCount) / SubBucketHalfCount) + 1);
+    }
+
+    // Middle of a bucket, clamped to the values that were recorded
+    double GetMiddle(size_t index) const
+    {
+        double middle = (GetLowerBound(index) + (GetWidth(index) - 1) / 2.0) * m_resolution;
+        return (std::min)((std::max)(middle, m_min), m_max);
+    }
+
+    double m_resolution;
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    double m_total;
+    double m_totalOfSquares;
+    double m_min;
+    double m_max;
+};
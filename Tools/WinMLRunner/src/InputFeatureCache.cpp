@@ -0,0 +1,53 @@
+#include "InputFeatureCache.h"
+
+InputFeatureCacheKey InputFeatureCache::MakeKey(const CommandLineArgs& args,
+                                                const ILearningModelFeatureDescriptor& description,
+                                                const std::wstring& imagePath, InputDataType inputDataType,
+                                                InputBindingType inputBindingType, uint32_t iterationNum)
+{
+    InputFeatureCacheKey key;
+    if (args.IsCSVInput())
+    {
+        key.InputPath = args.CsvPath();
+    }
+    else
+    {
+        key.InputPath = imagePath;
+    }
+    key.FeatureName = description.Name();
+    key.InputDataType = inputDataType;
+    key.InputBindingType = inputBindingType;
+    key.TensorizeFunc = args.TensorizeArgs().Func;
+    key.Scale = args.TensorizeArgs().Normalize.Scale;
+    key.Means = args.TensorizeArgs().Normalize.Means;
+    key.StdDevs = args.TensorizeArgs().Normalize.StdDevs;
+    key.BatchSize = args.BatchSize();
+    key.Variant = args.IsGarbageInput() ? iterationNum % args.GarbageInputVariants() : 0;
+    return key;
+}
+
+ILearningModelFeatureValue InputFeatureCache::GetOrCreate(
+    const InputFeatureCacheKey& key, const std::function<ILearningModelFeatureValue()>& createFeature)
+{
+    // The lock is held while the feature is created so that concurrent requests for the same key don't decode the
+    // same input twice.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto cachedFeature = m_features.find(key);
+    if (cachedFeature != m_features.end())
+    {
+        m_hits++;
+        return cachedFeature->second;
+    }
+    m_misses++;
+    auto feature = createFeature();
+    m_features.emplace(key, feature);
+    return feature;
+}
+
+void InputFeatureCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_features.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "CommandLineArgs.h"
+#include <map>
+#include <mutex>
+#include <functional>
+#include <tuple>
+
+// Identifies an input feature value that can be shared between iterations. Two requests with the same key would
+// generate identical feature values, so the value is built once and reused.
+struct InputFeatureCacheKey
+{
+    std::wstring InputPath;
+    std::wstring FeatureName;
+    InputDataType InputDataType;
+    InputBindingType InputBindingType;
+    TensorizeFuncs TensorizeFunc;
+    float Scale;
+    std::vector<float> Means;
+    std::vector<float> StdDevs;
+    uint32_t BatchSize;
+    // Garbage inputs are regenerated per variant so that iterations cycle through a pool of different values.
+    uint32_t Variant;
+
+    bool operator<(const InputFeatureCacheKey& other) const
+    {
+        return std::tie(InputPath, FeatureName, InputDataType, InputBindingType, TensorizeFunc, Scale, Means, StdDevs,
+                        BatchSize, Variant) < std::tie(other.InputPath, other.FeatureName, other.InputDataType,
+                                                       other.InputBindingType, other.TensorizeFunc, other.Scale,
+                                                       other.Means, other.StdDevs, other.BatchSize, other.Variant);
+    }
+};
+
+// Caches generated input feature values (tensors and video frames) for the lifetime of a model/device pair, so image
+// and CSV inputs are decoded once instead of once per iteration.
+class InputFeatureCache
+{
+public:
+    static InputFeatureCacheKey MakeKey(const CommandLineArgs& args, const ILearningModelFeatureDescriptor& description,
+                                        const std::wstring& imagePath, InputDataType inputDataType,
+                                        InputBindingType inputBindingType, uint32_t iterationNum);
+
+    ILearningModelFeatureValue GetOrCreate(const InputFeatureCacheKey& key,
+                                           const std::function<ILearningModelFeatureValue()>& createFeature);
+    void Clear();
+
+    uint32_t Hits() const { return m_hits; }
+    uint32_t Misses() const { return m_misses; }
+
+private:
+    std::mutex m_mutex;
+    std::map<InputFeatureCacheKey, ILearningModelFeatureValue> m_features;
+    uint32_t m_hits = 0;
+    uint32_t m_misses = 0;
+};
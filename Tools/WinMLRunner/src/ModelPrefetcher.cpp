@@ -0,0 +1,137 @@
+#include "ModelPrefetcher.h"
+#include <filesystem>
+#include <winrt/Windows.Foundation.Metadata.h>
+
+using namespace winrt::Windows::Foundation::Metadata;
+
+ModelPrefetcher::ModelPrefetcher(const std::vector<std::wstring>& modelPaths, const CommandLineArgs& args,
+                                 const std::vector<LearningModelDeviceWithMetadata>& deviceList,
+                                 const LearningModelSessionOptions& sessionOptions)
+    : m_modelPaths(modelPaths), m_args(args), m_deviceList(deviceList), m_sessionOptions(sessionOptions),
+      m_depth(args.PrefetchModels()), m_memoryLimitInBytes(static_cast<uint64_t>(args.PrefetchMemoryLimit()) << 20),
+      // Sessions are created with the options of the whole run, batch size sweeps create their own.
+      m_isPrefetchingSessions(args.IsPrefetchingSessions() && !args.IsBatchSizeSweep())
+{
+    // Enough workers for every node of one more model than models prefetched, so that the model being waited for is
+    // never queued behind them. With -MaxThreads the pool starts with the workers of one model instead and grows while
+    // the loads in flight block the model being waited for.
+    size_t nodesPerModel = m_isPrefetchingSessions ? (std::max)(deviceList.size(), size_t(1)) : 1;
+    if (args.MaxThreads() > 0)
+    {
+        m_workers = std::make_unique<ThreadPool>(static_cast<unsigned int>(nodesPerModel));
+        m_workers->SetElastic(args.MaxThreads());
+    }
+    else
+    {
+        m_workers = std::make_unique<ThreadPool>(static_cast<unsigned int>((m_depth + 1) * nodesPerModel));
+    }
+    m_graph = std::make_unique<TaskGraph>(*m_workers);
+}
+
+ModelPrefetcher::~ModelPrefetcher()
+{
+    // Models that haven't started loading yet won't be used anymore
+    m_graph->Cancel();
+}
+
+std::shared_ptr<PrefetchedModel> ModelPrefetcher::Acquire(size_t modelIndex)
+{
+    // The acquired model is always loaded, regardless of the memory limit
+    if (m_pendingModels.find(modelIndex) == m_pendingModels.end())
+    {
+        std::error_code error;
+        uint64_t sizeInBytes = std::filesystem::file_size(m_modelPaths[modelIndex], error);
+        Schedule(modelIndex, error ? 0 : sizeInBytes);
+    }
+    m_nextModelToSchedule = (std::max)(m_nextModelToSchedule, modelIndex + 1);
+
+    auto pendingModel = m_pendingModels.find(modelIndex);
+    PendingModel model = std::move(pendingModel->second);
+    m_pendingSizeInBytes -= model.SizeInBytes;
+    m_pendingModels.erase(pendingModel);
+
+    // Prefetch the models after this one while it is being evaluated
+    while (m_nextModelToSchedule < m_modelPaths.size() && m_nextModelToSchedule <= modelIndex + m_depth)
+    {
+        std::error_code error;
+        uint64_t sizeInBytes = std::filesystem::file_size(m_modelPaths[m_nextModelToSchedule], error);
+        sizeInBytes = error ? 0 : sizeInBytes;
+        if (m_memoryLimitInBytes > 0 && m_pendingSizeInBytes + sizeInBytes > m_memoryLimitInBytes)
+        {
+            break;
+        }
+        Schedule(m_nextModelToSchedule++, sizeInBytes);
+    }
+
+    for (TaskGraph::NodeId node : model.Nodes)
+    {
+        m_graph->Wait(node);
+    }
+    return model.Model;
+}
+
+void ModelPrefetcher::Schedule(size_t modelIndex, uint64_t sizeInBytes)
+{
+    m_pendingSizeInBytes += sizeInBytes;
+    PendingModel& pendingModel = m_pendingModels[modelIndex];
+    pendingModel.SizeInBytes = sizeInBytes;
+    pendingModel.Model = std::make_shared<PrefetchedModel>();
+    std::shared_ptr<PrefetchedModel> prefetchedModel = pendingModel.Model;
+    TaskGraph::NodeId load =
+        m_graph->AddNode([this, modelIndex, prefetchedModel]() { Load(modelIndex, *prefetchedModel); });
+    pendingModel.Nodes.push_back(load);
+    if (m_isPrefetchingSessions)
+    {
+        // Every session node fills its own slot, so they don't need to synchronize with each other
+        prefetchedModel->Sessions.resize(m_deviceList.size(), nullptr);
+        for (size_t deviceIndex = 0; deviceIndex < m_deviceList.size(); deviceIndex++)
+        {
+            prefetchedModel->SessionStatistics.push_back(std::make_unique<PerfCounterStatistics>());
+            pendingModel.Nodes.push_back(m_graph->AddNode(
+                [this, deviceIndex, prefetchedModel]() { CreateSession(deviceIndex, *prefetchedModel); }, { load }));
+        }
+    }
+}
+
+void ModelPrefetcher::Load(size_t modelIndex, PrefetchedModel& prefetchedModel) const
+{
+    bool capturePerf = m_args.IsPerformanceCapture() || m_args.IsPerIterationCapture();
+    if (capturePerf)
+    {
+        prefetchedModel.LoadStatistics.Enable();
+        prefetchedModel.LoadStatistics.SetTimingOnly(m_args.IsPerfTimingOnly());
+    }
+    for (uint32_t loadIteration = 0; loadIteration < m_args.NumLoadIterations(); loadIteration++)
+    {
+        prefetchedModel.LoadStatistics.Start();
+        prefetchedModel.Model = LearningModel::LoadFromFilePath(m_modelPaths[modelIndex]);
+        prefetchedModel.LoadStatistics.Stop();
+    }
+}
+
+void ModelPrefetcher::CreateSession(size_t deviceIndex, PrefetchedModel& prefetchedModel) const
+{
+    const auto& device = m_deviceList[deviceIndex];
+    PerfCounterStatistics& sessionStatistics = *prefetchedModel.SessionStatistics[deviceIndex];
+    if (m_args.IsPerformanceCapture())
+    {
+        sessionStatistics.Enable();
+        sessionStatistics.SetTimingOnly(m_args.IsPerfTimingOnly());
+    }
+    bool isSessionOptionsTypePresent =
+        ApiInformation::IsTypePresent(L"Windows.AI.MachineLearning.LearningModelSessionOptions");
+    try
+    {
+        sessionStatistics.Start();
+        prefetchedModel.Sessions[deviceIndex] =
+            isSessionOptionsTypePresent
+                ? LearningModelSession(prefetchedModel.Model, device.LearningModelDevice, m_sessionOptions)
+                : LearningModelSession(prefetchedModel.Model, device.LearningModelDevice);
+        sessionStatistics.Stop();
+    }
+    catch (hresult_error)
+    {
+        // The session is created again on the evaluating thread, which reports the failure
+        sessionStatistics.Reset();
+    }
+}
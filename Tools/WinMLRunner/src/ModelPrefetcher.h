@@ -0,0 +1,65 @@
+#pragma once
+#include "CommandLineArgs.h"
+#include "LearningModelDeviceHelper.h"
+#include "TimerHelper.h"
+#include "TaskGraph.h"
+#include <map>
+#include <memory>
+
+// A model that was loaded on a background thread, with the measurements taken while loading it so that they can be
+// merged into the profiler of the thread that evaluates it.
+struct PrefetchedModel
+{
+    LearningModel Model = nullptr;
+    PerfCounterStatistics LoadStatistics;
+    // One session per device of the device list when sessions are prefetched, otherwise empty. A session is set to
+    // nullptr once it has been taken.
+    std::vector<LearningModelSession> Sessions;
+    std::vector<std::unique_ptr<PerfCounterStatistics>> SessionStatistics;
+};
+
+// Loads the models that come after the one being evaluated on background threads, so that folder runs don't pay for
+// model loading between models. Models are loaded up to args.PrefetchModels() ahead, as long as the combined file size
+// of the models that were loaded but not acquired yet stays within args.PrefetchMemoryLimit(). Loading a model and
+// creating its session on every device are nodes of a task graph, so the sessions of a model are created in parallel.
+class ModelPrefetcher
+{
+public:
+    ModelPrefetcher(const std::vector<std::wstring>& modelPaths, const CommandLineArgs& args,
+                    const std::vector<LearningModelDeviceWithMetadata>& deviceList,
+                    const LearningModelSessionOptions& sessionOptions);
+    ~ModelPrefetcher();
+
+    // Waits for the model at modelIndex and starts prefetching the models after it. Rethrows the error if the model
+    // failed to load.
+    std::shared_ptr<PrefetchedModel> Acquire(size_t modelIndex);
+
+private:
+    struct PendingModel
+    {
+        uint64_t SizeInBytes;
+        std::shared_ptr<PrefetchedModel> Model;
+        // The load node first, then the session nodes
+        std::vector<TaskGraph::NodeId> Nodes;
+    };
+
+    void Schedule(size_t modelIndex, uint64_t sizeInBytes);
+    void Load(size_t modelIndex, PrefetchedModel& prefetchedModel) const;
+    void CreateSession(size_t deviceIndex, PrefetchedModel& prefetchedModel) const;
+
+    const std::vector<std::wstring>& m_modelPaths;
+    const CommandLineArgs& m_args;
+    const std::vector<LearningModelDeviceWithMetadata>& m_deviceList;
+    LearningModelSessionOptions m_sessionOptions;
+    uint32_t m_depth;
+    uint64_t m_memoryLimitInBytes;
+
+    std::map<size_t, PendingModel> m_pendingModels;
+    size_t m_nextModelToSchedule = 0;
+    uint64_t m_pendingSizeInBytes = 0;
+    bool m_isPrefetchingSessions;
+    // Declared last so that the workers are joined before the state they use is destroyed, and the graph is destroyed
+    // before the workers it runs on.
+    std::unique_ptr<ThreadPool> m_workers;
+    std::unique_ptr<TaskGraph> m_graph;
+};
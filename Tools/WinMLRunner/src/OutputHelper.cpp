@@ -13,6 +13,7 @@
 #include "TimerHelper.h"
 #include "LearningModelDeviceHelper.h"
 #include "OutputHelper.h"
+#include "Parallel.h"
 
 #ifdef USE_WINML_NUGET
 using namespace winrt::Microsoft::AI::MachineLearning;
@@ -156,6 +157,26 @@ void OutputHelper::PrintLearningModelDevice(const LearningModelDeviceWithMetadat
     }
 }
 
+// Tail times of an interval, which the average and standard deviation hide
+static void PrintTimePercentiles(const char* name, const PerfCounterStatistics& statistics)
+{
+    std::cout << "  " << name << " Percentiles: p50 " << statistics.GetTimePercentile(50) << " ms, p90 "
+              << statistics.GetTimePercentile(90) << " ms, p99 " << statistics.GetTimePercentile(99) << " ms, p99.9 "
+              << statistics.GetTimePercentile(99.9) << " ms, max " << statistics.GetMax(CounterType::TIMER) << " ms"
+              << std::endl;
+}
+
+// Statistics of an interval's times that outliers of a noisy run barely move
+static void PrintRobustTimeStatistics(const char* name, const PerfCounterStatistics& statistics)
+{
+    std::pair<double, double> interval = statistics.GetTimeConfidenceInterval(0.95);
+    std::cout << "  10% Trimmed Mean " << name << ": " << statistics.GetTimeTrimmedMean(0.1) << " ms" << std::endl;
+    std::cout << "  Median Absolute Deviation " << name << ": " << statistics.GetTimeMedianAbsoluteDeviation() << " ms"
+              << std::endl;
+    std::cout << "  95% Confidence Interval of Average " << name << ": " << interval.first << " to " << interval.second
+              << " ms" << std::endl;
+}
+
 void OutputHelper::PrintResults(const Profiler<WINML_MODEL_TEST_PERF>& profiler, uint32_t numIterations, DeviceType deviceType,
                     InputBindingType inputBindingType, InputDataType inputDataType,
                     DeviceCreationLocation deviceCreationLocation, bool isPerformanceConsoleOutputVerbose) const
@@ -260,6 +281,11 @@ void OutputHelper::PrintResults(const Profiler<WINML_MODEL_TEST_PERF>& profiler,
             TypeHelper::Stringify(inputBindingType).c_str(), TypeHelper::Stringify(inputDataType).c_str(),
             TypeHelper::Stringify(deviceCreationLocation).c_str());
 
+    const ProfilingOverhead& overhead = profiler.GetOverhead();
+    std::cout << "\nProfiler overhead" << (profiler[EVAL_MODEL].IsTimingOnly() ? " (timing only)" : "") << ": "
+              << overhead.Call << " ms per measurement, " << overhead.Interval << " ms of it subtracted from every time"
+              << std::endl;
+
     std::cout << "\nFirst Iteration Performance (load, bind, session creation, and evaluate): " << std::endl;
     std::cout << "  Load: " << loadTime << " ms" << std::endl;
     std::cout << "  Bind: " << firstBindTime << " ms" << std::endl;
@@ -334,18 +360,22 @@ void OutputHelper::PrintResults(const Profiler<WINML_MODEL_TEST_PERF>& profiler,
                 "only bind and evaluate)\n",
                 2, numIterations);
         std::cout << "  Average Bind: " << averageBindTime << " ms" << std::endl;
+        PrintTimePercentiles("Bind", profiler[BIND_VALUE]);
         if (isPerformanceConsoleOutputVerbose)
         {
             std::cout << "  Minimum Bind: " << minBindTime << " ms" << std::endl;
             std::cout << "  Maximum Bind: " << maxBindTime << " ms" << std::endl;
             std::cout << "  Standard Deviation Bind: " << stdevBindTime << " ms" << std::endl;
+            PrintRobustTimeStatistics("Bind", profiler[BIND_VALUE]);
         }
         std::cout << "  Average Evaluate: " << averageEvalTime << " ms" << std::endl;
+        PrintTimePercentiles("Evaluate", profiler[EVAL_MODEL]);
         if (isPerformanceConsoleOutputVerbose)
         {
             std::cout << "  Minimum Evaluate: " << minEvalTime << " ms" << std::endl;
             std::cout << "  Maximum Evaluate: " << maxEvalTime << " ms" << std::endl;
             std::cout << "  Standard Deviation Evaluate: " << stdevEvalTime << " ms" << std::endl;
+            PrintRobustTimeStatistics("Evaluate", profiler[EVAL_MODEL]);
         }
 
         std::cout << "\n  Average Working Set Memory usage (bind): " << averageBindMemoryUsage << " MB"
@@ -356,6 +386,8 @@ void OutputHelper::PrintResults(const Profiler<WINML_MODEL_TEST_PERF>& profiler,
             std::cout << "  Max Working Set Memory usage (bind): " << maxBindMemoryUsage << " MB" << std::endl;
             std::cout << "  Standard Deviation Working Set Memory usage (bind): " << stdevBindMemoryUsage << " MB"
                         << std::endl;
+            std::cout << "  Median Working Set Memory usage (bind): "
+                      << profiler[BIND_VALUE].GetMedian(CounterType::WORKING_SET_USAGE) << " MB" << std::endl;
         }
         std::cout << "  Average Working Set Memory usage (evaluate): " << averageEvalMemoryUsage << " MB"
                     << std::endl;
@@ -365,6 +397,8 @@ void OutputHelper::PrintResults(const Profiler<WINML_MODEL_TEST_PERF>& profiler,
             std::cout << "  Max Working Set Memory usage (evaluate): " << maxEvalMemoryUsage << " MB" << std::endl;
             std::cout << "  Standard Deviation Working Set Memory usage (evaluate): " << stdevEvalMemoryUsage
                         << " MB" << std::endl;
+            std::cout << "  Median Working Set Memory usage (evaluate): "
+                      << profiler[EVAL_MODEL].GetMedian(CounterType::WORKING_SET_USAGE) << " MB" << std::endl;
         }
 
         std::cout << "\n  Average Dedicated Memory usage (bind): " << averageBindDedicatedMemoryUsage << " MB"
@@ -565,9 +599,47 @@ void OutputHelper::SetDefaultCSVIterationResult(uint32_t iterationNum, const Com
 
 void OutputHelper::SetCSVFileName(const std::wstring& fileName) { m_csvFileName = fileName; }
 
+AsyncTask<void> OutputHelper::AppendToFileAsync(std::wstring path, std::string contents)
+{
+    if (!m_writer)
+    {
+        m_writer = std::make_unique<ThreadPool>(1);
+    }
+    co_await ResumeOn(*m_writer);
+    std::ofstream fout;
+    fout.open(path, std::ios_base::app);
+    fout << contents;
+}
+
+void OutputHelper::AppendToFileInBackground(std::wstring path, std::string contents)
+{
+    // Also serializes the creation of m_writer, which the write does before its first suspension
+    std::lock_guard<std::mutex> lock(m_pendingWritesMutex);
+    m_pendingWrites.erase(std::remove_if(m_pendingWrites.begin(), m_pendingWrites.end(),
+                                         [](const AsyncTask<void>& write) { return write.IsCompleted(); }),
+                          m_pendingWrites.end());
+    m_pendingWrites.push_back(AppendToFileAsync(std::move(path), std::move(contents)));
+    m_pendingWrites.back().Start();
+}
+
+void OutputHelper::WaitForPendingWrites()
+{
+    std::vector<AsyncTask<void>> pendingWrites;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingWritesMutex);
+        pendingWrites.swap(m_pendingWrites);
+    }
+    if (!pendingWrites.empty())
+    {
+        WhenAll(std::move(pendingWrites)).Get();
+    }
+}
+
 void OutputHelper::WritePerIterationPerformance(const CommandLineArgs& args, const std::wstring model,
                                     const std::wstring imagePath)
 {
+    // The summary comes after the tensors it refers to
+    WaitForPendingWrites();
     if (m_csvFileNamePerIterationSummary.length() > 0)
     {
         bool bNewFile = false;
@@ -676,63 +748,116 @@ void OutputHelper::WritePerIterationPerformance(const CommandLineArgs& args, con
     }
 }
 
-template <typename T>
-void OutputHelper::ProcessTensorResult(const CommandLineArgs& args, const void* buffer, const uint32_t uCapacity,
-                         std::vector<std::pair<float, int>>& maxValues, std::ofstream& fout, unsigned int k)
+// Keeps the k highest values offered to it in a priority queue that pops the lowest value first
+class TopKValues
 {
-    // Create a priority queue of size k that pops the lowest value first
-    // We will remove lowest values as we iterate over all the values
-    auto cmp = [](std::pair<float, int> x, std::pair<float, int> y) { return x.first > y.first; };
-    std::priority_queue<std::pair<float, int>, std::vector<std::pair<float, int>>, decltype(cmp)> topKvalues(cmp);
+public:
+    explicit TopKValues(unsigned int k) : m_k(k) {}
 
-    T* tensor = (T*)buffer;
-    int size = uCapacity / sizeof(T);
-    for (int i = 0; i < size; i++)
+    void Offer(float val, int index)
     {
-        float val = 0;
-        if (!std::is_same<T, HALF>::value)
+        if (m_topKvalues.size() < m_k)
         {
-            val = *(tensor + i);
+            m_topKvalues.push({ val, index });
         }
-        else
-        {
-            val = XMConvertHalfToFloat(static_cast<HALF>(*(tensor + i)));
-        }
-        if (args.IsSaveTensor())
+        else if (m_k > 0)
         {
-            fout << i << "," << val << std::endl;
+            auto maxValue = m_topKvalues.top().first;
+            if (maxValue < val)
+            {
+                m_topKvalues.pop();
+                m_topKvalues.push({ val, index });
+            }
         }
+    }
 
-        if (topKvalues.size() < k)
+    // Empties the queue into values, lowest value first
+    void MoveTo(std::vector<std::pair<float, int>>& values)
+    {
+        while (!m_topKvalues.empty())
         {
-            topKvalues.push({ val, i });
+            values.push_back(m_topKvalues.top());
+            m_topKvalues.pop();
         }
-        else if (k > 0)
+    }
+
+private:
+    struct PopLowestFirst
+    {
+        bool operator()(std::pair<float, int> x, std::pair<float, int> y) const { return x.first > y.first; }
+    };
+
+    unsigned int m_k;
+    std::priority_queue<std::pair<float, int>, std::vector<std::pair<float, int>>, PopLowestFirst> m_topKvalues;
+};
+
+template <typename T>
+static float GetTensorValue(const T* tensor, int i)
+{
+    if (!std::is_same<T, HALF>::value)
+    {
+        return static_cast<float>(*(tensor + i));
+    }
+    else
+    {
+        return XMConvertHalfToFloat(static_cast<HALF>(*(tensor + i)));
+    }
+}
+
+template <typename T>
+void OutputHelper::ProcessTensorResult(const CommandLineArgs& args, const void* buffer, const uint32_t uCapacity,
+                         std::vector<std::pair<float, int>>& maxValues, std::ostream& fout, unsigned int k)
+{
+    // We will remove lowest values as we iterate over all the values
+    TopKValues topKvalues(k);
+
+    T* tensor = (T*)buffer;
+    int size = uCapacity / sizeof(T);
+    if (args.IsSaveTensor())
+    {
+        // Values are written in order, so this stays on one thread
+        for (int i = 0; i < size; i++)
         {
-            auto maxValue = topKvalues.top().first;
-            if (maxValue < val)
-            {
-                topKvalues.pop();
-                topKvalues.push({ val, i });
-            }
+            float val = GetTensorValue(tensor, i);
+            fout << i << "," << val << std::endl;
+            topKvalues.Offer(val, i);
         }
     }
-    while (!topKvalues.empty())
+    else
     {
-        auto pair = topKvalues.top();
-        maxValues.push_back(pair);
-        topKvalues.pop();
+        // Every chunk keeps its own top k values, the top k of all values are among them
+        std::vector<std::pair<float, int>> candidates = ParallelReduce(
+            0, size, 0, std::vector<std::pair<float, int>>(),
+            [tensor, k](size_t first, size_t last) {
+                TopKValues chunkTopKvalues(k);
+                for (size_t i = first; i < last; i++)
+                {
+                    chunkTopKvalues.Offer(GetTensorValue(tensor, static_cast<int>(i)), static_cast<int>(i));
+                }
+                std::vector<std::pair<float, int>> chunkCandidates;
+                chunkTopKvalues.MoveTo(chunkCandidates);
+                return chunkCandidates;
+            },
+            [](std::vector<std::pair<float, int>> candidates, std::vector<std::pair<float, int>> chunkCandidates) {
+                candidates.insert(candidates.end(), chunkCandidates.begin(), chunkCandidates.end());
+                return candidates;
+            });
+        for (auto& candidate : candidates)
+        {
+            topKvalues.Offer(candidate.first, candidate.second);
+        }
     }
+    topKvalues.MoveTo(maxValues);
     // Put vector in order of highest value to lowest
     std::reverse(maxValues.begin(), maxValues.end());
 }
 template void OutputHelper::ProcessTensorResult<float>(const CommandLineArgs& args, const void* buffer, const uint32_t uCapacity,
-                                                       std::vector<std::pair<float, int>>& maxValues, std::ofstream& fout,
+                                                       std::vector<std::pair<float, int>>& maxValues, std::ostream& fout,
                                                        unsigned int k);
 template void OutputHelper::ProcessTensorResult<HALF>(const CommandLineArgs& args, const void* buffer,
                                                        const uint32_t uCapacity,
                                                        std::vector<std::pair<float, int>>& maxValues,
-                                                       std::ofstream& fout, unsigned int k);
+                                                       std::ostream& fout, unsigned int k);
 
 void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PERF>& profiler, int numIterations,
                             std::wstring model, const std::string& deviceType, const std::string& inputBinding,
@@ -755,6 +880,13 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
     double stdevBindTime = profiler[BIND_VALUE].GetStdev(CounterType::TIMER);
     double minBindTime = profiler[BIND_VALUE].GetMin(CounterType::TIMER);
     double maxBindTime = profiler[BIND_VALUE].GetMax(CounterType::TIMER);
+    double p50BindTime = profiler[BIND_VALUE].GetTimePercentile(50);
+    double p90BindTime = profiler[BIND_VALUE].GetTimePercentile(90);
+    double p99BindTime = profiler[BIND_VALUE].GetTimePercentile(99);
+    double p999BindTime = profiler[BIND_VALUE].GetTimePercentile(99.9);
+    double trimmedMeanBindTime = profiler[BIND_VALUE].GetTimeTrimmedMean(0.1);
+    double madBindTime = profiler[BIND_VALUE].GetTimeMedianAbsoluteDeviation();
+    std::pair<double, double> averageBindTimeInterval = profiler[BIND_VALUE].GetTimeConfidenceInterval(0.95);
 
     double averageFirstBindTime = profiler[BIND_VALUE_FIRST_RUN].GetAverage(CounterType::TIMER);
     double stdevFirstBindTime = profiler[BIND_VALUE_FIRST_RUN].GetStdev(CounterType::TIMER);
@@ -765,6 +897,13 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
     double stdevEvalTime = profiler[EVAL_MODEL].GetStdev(CounterType::TIMER);
     double minEvalTime = profiler[EVAL_MODEL].GetMin(CounterType::TIMER);
     double maxEvalTime = profiler[EVAL_MODEL].GetMax(CounterType::TIMER);
+    double p50EvalTime = profiler[EVAL_MODEL].GetTimePercentile(50);
+    double p90EvalTime = profiler[EVAL_MODEL].GetTimePercentile(90);
+    double p99EvalTime = profiler[EVAL_MODEL].GetTimePercentile(99);
+    double p999EvalTime = profiler[EVAL_MODEL].GetTimePercentile(99.9);
+    double trimmedMeanEvalTime = profiler[EVAL_MODEL].GetTimeTrimmedMean(0.1);
+    double madEvalTime = profiler[EVAL_MODEL].GetTimeMedianAbsoluteDeviation();
+    std::pair<double, double> averageEvalTimeInterval = profiler[EVAL_MODEL].GetTimeConfidenceInterval(0.95);
 
     double averageFirstEvalTime = profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::TIMER);
     double stdevFirstEvalTime = profiler[EVAL_MODEL_FIRST_RUN].GetStdev(CounterType::TIMER);
@@ -805,11 +944,11 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
     double averageFirstEvalWorkingSetMemoryUsage =
         profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::WORKING_SET_USAGE);
     double stdevFirstEvalWorkingSetMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::WORKING_SET_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetStdev(CounterType::WORKING_SET_USAGE);
     double minFirstEvalWorkingSetMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::WORKING_SET_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMin(CounterType::WORKING_SET_USAGE);
     double maxFirstEvalWorkingSetMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::WORKING_SET_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMax(CounterType::WORKING_SET_USAGE);
 
     double averageLoadDedicatedMemoryUsage = profiler[LOAD_MODEL].GetAverage(CounterType::GPU_DEDICATED_MEM_USAGE);
     double stdevLoadDedicatedMemoryUsage = profiler[LOAD_MODEL].GetStdev(CounterType::GPU_DEDICATED_MEM_USAGE);
@@ -847,11 +986,11 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
     double averageFirstEvalDedicatedMemoryUsage =
         profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_DEDICATED_MEM_USAGE);
     double stdevFirstEvalDedicatedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_DEDICATED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetStdev(CounterType::GPU_DEDICATED_MEM_USAGE);
     double minFirstEvalDedicatedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_DEDICATED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMin(CounterType::GPU_DEDICATED_MEM_USAGE);
     double maxFirstEvalDedicatedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_DEDICATED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMax(CounterType::GPU_DEDICATED_MEM_USAGE);
 
     double averageLoadSharedMemoryUsage = profiler[LOAD_MODEL].GetAverage(CounterType::GPU_SHARED_MEM_USAGE);
     double stdevLoadSharedMemoryUsage = profiler[LOAD_MODEL].GetStdev(CounterType::GPU_SHARED_MEM_USAGE);
@@ -885,11 +1024,11 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
     double averageFirstEvalSharedMemoryUsage =
         profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_SHARED_MEM_USAGE);
     double stdevFirstEvalSharedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_SHARED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetStdev(CounterType::GPU_SHARED_MEM_USAGE);
     double minFirstEvalSharedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_SHARED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMin(CounterType::GPU_SHARED_MEM_USAGE);
     double maxFirstEvalSharedMemoryUsage =
-        profiler[EVAL_MODEL_FIRST_RUN].GetAverage(CounterType::GPU_SHARED_MEM_USAGE);
+        profiler[EVAL_MODEL_FIRST_RUN].GetMax(CounterType::GPU_SHARED_MEM_USAGE);
 
     if (!m_csvFileName.empty())
     {
@@ -960,6 +1099,22 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
                     << ","
                     << "max bind (ms)"
                     << ","
+                    << "p50 bind (ms)"
+                    << ","
+                    << "p90 bind (ms)"
+                    << ","
+                    << "p99 bind (ms)"
+                    << ","
+                    << "p99.9 bind (ms)"
+                    << ","
+                    << "10% trimmed mean bind (ms)"
+                    << ","
+                    << "median absolute deviation bind (ms)"
+                    << ","
+                    << "average bind 95% confidence interval lower bound (ms)"
+                    << ","
+                    << "average bind 95% confidence interval upper bound (ms)"
+                    << ","
                     << "average first evaluate (ms)"
                     << ","
                     << "standard deviation first evaluate (ms)"
@@ -976,6 +1131,22 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
                     << ","
                     << "max evaluate (ms)"
                     << ","
+                    << "p50 evaluate (ms)"
+                    << ","
+                    << "p90 evaluate (ms)"
+                    << ","
+                    << "p99 evaluate (ms)"
+                    << ","
+                    << "p99.9 evaluate (ms)"
+                    << ","
+                    << "10% trimmed mean evaluate (ms)"
+                    << ","
+                    << "median absolute deviation evaluate (ms)"
+                    << ","
+                    << "average evaluate 95% confidence interval lower bound (ms)"
+                    << ","
+                    << "average evaluate 95% confidence interval upper bound (ms)"
+                    << ","
                     << "load average working set memory (MB)"
                     << ","
                     << "load standard deviation working set memory (MB)"
@@ -1134,10 +1305,21 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
                 << averageFirstBindTime << "," << stdevFirstBindTime << "," << minFirstBindTime << ","
                 << maxFirstBindTime << "," << (numIterations <= 1 ? 0 : averageBindTime) << ","
                 << (numIterations <= 1 ? 0 : stdevBindTime) << "," << (numIterations <= 1 ? 0 : minBindTime) << ","
-                << (numIterations <= 1 ? 0 : maxBindTime) << "," << averageFirstEvalTime << "," << stdevFirstEvalTime
+                << (numIterations <= 1 ? 0 : maxBindTime) << "," << (numIterations <= 1 ? 0 : p50BindTime) << ","
+                << (numIterations <= 1 ? 0 : p90BindTime) << "," << (numIterations <= 1 ? 0 : p99BindTime) << ","
+                << (numIterations <= 1 ? 0 : p999BindTime) << "," << (numIterations <= 1 ? 0 : trimmedMeanBindTime)
+                << "," << (numIterations <= 1 ? 0 : madBindTime) << ","
+                << (numIterations <= 1 ? 0 : averageBindTimeInterval.first) << ","
+                << (numIterations <= 1 ? 0 : averageBindTimeInterval.second) << "," << averageFirstEvalTime << ","
+                << stdevFirstEvalTime
                 << "," << minFirstEvalTime << "," << maxFirstEvalTime << ","
                 << (numIterations <= 1 ? 0 : averageEvalTime) << "," << (numIterations <= 1 ? 0 : stdevEvalTime) << ","
                 << (numIterations <= 1 ? 0 : minEvalTime) << "," << (numIterations <= 1 ? 0 : maxEvalTime) << ","
+                << (numIterations <= 1 ? 0 : p50EvalTime) << "," << (numIterations <= 1 ? 0 : p90EvalTime) << ","
+                << (numIterations <= 1 ? 0 : p99EvalTime) << "," << (numIterations <= 1 ? 0 : p999EvalTime) << ","
+                << (numIterations <= 1 ? 0 : trimmedMeanEvalTime) << "," << (numIterations <= 1 ? 0 : madEvalTime)
+                << "," << (numIterations <= 1 ? 0 : averageEvalTimeInterval.first) << ","
+                << (numIterations <= 1 ? 0 : averageEvalTimeInterval.second) << ","
 
                 << averageLoadWorkingSetMemoryUsage << "," << stdevLoadWorkingSetMemoryUsage << ","
                 << minLoadWorkingSetMemoryUsage << "," << maxLoadWorkingSetMemoryUsage << ","
@@ -1147,14 +1329,14 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
                 << minFirstBindWorkingSetMemoryUsage << "," << maxFirstBindWorkingSetMemoryUsage << ","
                 << (numIterations <= 1 ? 0 : averageBindWorkingSetMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : stdevBindWorkingSetMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : maxBindWorkingSetMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : minBindWorkingSetMemoryUsage) << ","
-                << averageFirstBindWorkingSetMemoryUsage << "," << stdevFirstBindWorkingSetMemoryUsage << ","
-                << minFirstBindWorkingSetMemoryUsage << "," << maxFirstBindWorkingSetMemoryUsage << ","
+                << (numIterations <= 1 ? 0 : maxBindWorkingSetMemoryUsage) << ","
+                << averageFirstEvalWorkingSetMemoryUsage << "," << stdevFirstEvalWorkingSetMemoryUsage << ","
+                << minFirstEvalWorkingSetMemoryUsage << "," << maxFirstEvalWorkingSetMemoryUsage << ","
                 << (numIterations <= 1 ? 0 : averageEvalWorkingSetMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : stdevEvalWorkingSetMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : maxEvalWorkingSetMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : minEvalWorkingSetMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : maxEvalWorkingSetMemoryUsage) << ","
 
                 << averageLoadDedicatedMemoryUsage << "," << stdevLoadDedicatedMemoryUsage << ","
                 << minLoadDedicatedMemoryUsage << "," << maxLoadDedicatedMemoryUsage << ","
@@ -1164,29 +1346,31 @@ void OutputHelper::WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PER
                 << minFirstBindDedicatedMemoryUsage << "," << maxFirstBindDedicatedMemoryUsage << ","
                 << (numIterations <= 1 ? 0 : averageBindDedicatedMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : stdevBindDedicatedMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : maxBindDedicatedMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : minBindDedicatedMemoryUsage) << ","
-                << averageFirstBindDedicatedMemoryUsage << "," << stdevFirstBindDedicatedMemoryUsage << ","
-                << minFirstBindDedicatedMemoryUsage << "," << maxFirstBindDedicatedMemoryUsage << ","
+                << (numIterations <= 1 ? 0 : maxBindDedicatedMemoryUsage) << ","
+                << averageFirstEvalDedicatedMemoryUsage << "," << stdevFirstEvalDedicatedMemoryUsage << ","
+                << minFirstEvalDedicatedMemoryUsage << "," << maxFirstEvalDedicatedMemoryUsage << ","
                 << (numIterations <= 1 ? 0 : averageEvalDedicatedMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : stdevEvalDedicatedMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : maxEvalDedicatedMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : minEvalDedicatedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : maxEvalDedicatedMemoryUsage) << ","
 
-                << averageLoadSharedMemoryUsage << "," << stdevLoadSharedMemoryUsage << "," << minLoadSharedMemoryUsage
-                << "," << maxLoadSharedMemoryUsage << "," << averageCreateSessionSharedMemoryUsage << ","
-                << stdevCreateSessionSharedMemoryUsage << "," << minCreateSessionSharedMemoryUsage << ","
-                << maxCreateSessionSharedMemoryUsage << "," << averageFirstBindSharedMemoryUsage << ","
-                << stdevFirstBindSharedMemoryUsage << "," << minFirstBindSharedMemoryUsage << ","
-                << maxFirstBindSharedMemoryUsage << "," << (numIterations <= 1 ? 0 : averageBindSharedMemoryUsage)
-                << "," << (numIterations <= 1 ? 0 : stdevBindSharedMemoryUsage) << ","
+                << averageLoadSharedMemoryUsage << "," << stdevLoadSharedMemoryUsage << ","
+                << minLoadSharedMemoryUsage << "," << maxLoadSharedMemoryUsage << ","
+                << averageCreateSessionSharedMemoryUsage << "," << stdevCreateSessionSharedMemoryUsage << ","
+                << minCreateSessionSharedMemoryUsage << "," << maxCreateSessionSharedMemoryUsage << ","
+                << averageFirstBindSharedMemoryUsage << "," << stdevFirstBindSharedMemoryUsage << ","
+                << minFirstBindSharedMemoryUsage << "," << maxFirstBindSharedMemoryUsage << ","
+                << (numIterations <= 1 ? 0 : averageBindSharedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : stdevBindSharedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : minBindSharedMemoryUsage) << ","
                 << (numIterations <= 1 ? 0 : maxBindSharedMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : minBindSharedMemoryUsage) << "," << averageFirstBindSharedMemoryUsage
-                << "," << stdevFirstBindSharedMemoryUsage << "," << minFirstBindSharedMemoryUsage << ","
-                << maxFirstBindSharedMemoryUsage << "," << (numIterations <= 1 ? 0 : averageEvalSharedMemoryUsage)
-                << "," << (numIterations <= 1 ? 0 : stdevEvalSharedMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : maxEvalSharedMemoryUsage) << ","
-                << (numIterations <= 1 ? 0 : minEvalSharedMemoryUsage) << ",";
+                << averageFirstEvalSharedMemoryUsage << "," << stdevFirstEvalSharedMemoryUsage << ","
+                << minFirstEvalSharedMemoryUsage << "," << maxFirstEvalSharedMemoryUsage << ","
+                << (numIterations <= 1 ? 0 : averageEvalSharedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : stdevEvalSharedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : minEvalSharedMemoryUsage) << ","
+                << (numIterations <= 1 ? 0 : maxEvalSharedMemoryUsage) << ",";
         for (auto metaDataPair : perfFileMetadata)
         {
             fout << metaDataPair.second << ",";
@@ -4,6 +4,7 @@
 #endif
 #include "TimerHelper.h"
 #include "LearningModelDeviceHelper.h"
+#include "AsyncTask.h"
 // Stores performance information and handles output to the command line and CSV files.
 class OutputHelper
 {
@@ -47,6 +48,11 @@ public:
     void SetCSVFileName(const std::wstring& fileName);
     void WritePerIterationPerformance(const CommandLineArgs& args, const std::wstring model,
                                       const std::wstring imagePath);
+    // Appends contents to the file on a writer thread, after the writes that were started before this one
+    AsyncTask<void> AppendToFileAsync(std::wstring path, std::string contents);
+    // Starts AppendToFileAsync without waiting for it, so evaluations don't wait for the disk
+    void AppendToFileInBackground(std::wstring path, std::string contents);
+    void WaitForPendingWrites();
     void WritePerformanceDataToCSV(const Profiler<WINML_MODEL_TEST_PERF>& profiler, int numIterations,
                                    std::wstring model, const std::string& deviceType, const std::string& inputBinding,
                                    const std::string& inputType, const std::string& deviceCreationLocation,
@@ -57,7 +63,7 @@ public:
     static bool doesModelContainFP16(const LearningModel& model);
     template <typename T>
     static void ProcessTensorResult(const CommandLineArgs& args, const void* buffer, const uint32_t uCapacity,
-                                    std::vector<std::pair<float, int>>& maxValues, std::ofstream& fout, unsigned int k);
+                                    std::vector<std::pair<float, int>>& maxValues, std::ostream& fout, unsigned int k);
     // PIX markers only work on amd64
 #if defined(_AMD64_)
     com_ptr<IDXGraphicsAnalysis>& GetGraphicsAnalysis() { return m_graphicsAnalysis; }
@@ -84,6 +90,13 @@ private:
     std::vector<std::string> m_outputResult;
     std::vector<int> m_outputTensorHash;
 
+    // One writer thread keeps appends to the same file in order. Declared before the pending writes, whose
+    // destructors wait for them to complete before the writer is joined.
+    std::unique_ptr<ThreadPool> m_writer;
+    std::vector<AsyncTask<void>> m_pendingWrites;
+    // Pipeline and throughput workers save their results concurrently
+    std::mutex m_pendingWritesMutex;
+
 #if defined(_AMD64_)
     // PIX markers only work on amd64
     com_ptr<IDXGraphicsAnalysis> m_graphicsAnalysis = nullptr;
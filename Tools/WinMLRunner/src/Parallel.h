@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadPool.h"
+
+// Data parallel loops over index ranges. A range is split into chunks of grain indices, or of an automatic grain of
+// at least ParallelMinGrain indices and at most ParallelMaxChunks chunks when grain is 0. The chunking only depends on
+// the range and the grain, never on the number of CPUs, so ParallelReduce gives the same result on every machine.
+// Ranges of a single chunk run inline on the calling thread.
+constexpr size_t ParallelMinGrain = 4096;
+constexpr size_t ParallelMaxChunks = 256;
+
+// The calling thread works on its loop too, so the shared pool has one worker less than there are CPUs
+inline unsigned GetParallelWorkers() { return (std::max)(std::thread::hardware_concurrency(), 2u) - 1; }
+
+inline ThreadPool& GetParallelPool()
+{
+    static ThreadPool pool(GetParallelWorkers());
+    return pool;
+}
+
+inline size_t GetParallelGrain(size_t begin, size_t end, size_t grain)
+{
+    size_t count = end > begin ? end - begin : 0;
+    return grain > 0 ? grain : (std::max)(ParallelMinGrain, (count + ParallelMaxChunks - 1) / ParallelMaxChunks);
+}
+
+inline size_t GetParallelChunks(size_t begin, size_t end, size_t grain)
+{
+    size_t count = end > begin ? end - begin : 0;
+    grain = GetParallelGrain(begin, end, grain);
+    return (count + grain - 1) / grain;
+}
+
+// Calls body(chunk, chunkBegin, chunkEnd) for every chunk of [begin, end) and returns once all of them have run.
+// Rethrows the first exception a chunk threw.
+template <typename Body>
+void ParallelForChunks(size_t begin, size_t end, size_t grain, Body&& body)
+{
+    grain = GetParallelGrain(begin, end, grain);
+    size_t numChunks = GetParallelChunks(begin, end, grain);
+    if (numChunks <= 1)
+    {
+        if (numChunks == 1)
+        {
+            body(0, begin, end);
+        }
+        return;
+    }
+
+    struct LoopState
+    {
+        std::atomic<size_t> NextChunk{ 0 };
+        std::atomic<size_t> CompletedChunks{ 0 };
+        std::mutex Mutex;
+        std::condition_variable Completed;
+        std::exception_ptr Error;
+    };
+    // Shared with the helpers, because a helper that only starts after the loop is done still looks for a chunk.
+    // It never finds one, so it never touches the body.
+    auto state = std::make_shared<LoopState>();
+    auto runChunks = [state, &body, begin, end, grain, numChunks]() {
+        for (size_t chunk = state->NextChunk++; chunk < numChunks; chunk = state->NextChunk++)
+        {
+            try
+            {
+                body(chunk, begin + chunk * grain, (std::min)(end, begin + (chunk + 1) * grain));
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                if (!state->Error)
+                {
+                    state->Error = std::current_exception();
+                }
+            }
+            if (++state->CompletedChunks == numChunks)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                state->Completed.notify_all();
+            }
+        }
+    };
+
+    ThreadPool& pool = GetParallelPool();
+    size_t numHelpers = (std::min)(numChunks - 1, static_cast<size_t>(GetParallelWorkers()));
+    for (size_t helper = 0; helper < numHelpers; helper++)
+    {
+        pool.Post(runChunks);
+    }
+    // Only waits for chunks that other threads are already running, so a loop started from a pool worker can't wait
+    // on helpers queued behind it.
+    runChunks();
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Completed.wait(lock, [&state, numChunks] { return state->CompletedChunks == numChunks; });
+    if (state->Error)
+    {
+        std::rethrow_exception(state->Error);
+    }
+}
+
+// Calls body(chunkBegin, chunkEnd) for every chunk of [begin, end)
+template <typename Body>
+void ParallelFor(size_t begin, size_t end, size_t grain, Body&& body)
+{
+    ParallelForChunks(begin, end, grain,
+                      [&body](size_t, size_t chunkBegin, size_t chunkEnd) { body(chunkBegin, chunkEnd); });
+}
+
+// Maps every chunk of [begin, end) with map(chunkBegin, chunkEnd) and folds the results in chunk order, starting from
+// identity, with combine(accumulated, chunkResult).
+template <typename T, typename Map, typename Combine>
+T ParallelReduce(size_t begin, size_t end, size_t grain, T identity, Map&& map, Combine&& combine)
+{
+    std::vector<T> chunkResults(GetParallelChunks(begin, end, grain), identity);
+    ParallelForChunks(begin, end, grain, [&](size_t chunk, size_t chunkBegin, size_t chunkEnd) {
+        chunkResults[chunk] = map(chunkBegin, chunkEnd);
+    });
+    T result = std::move(identity);
+    for (T& chunkResult : chunkResults)
+    {
+        result = combine(std::move(result), std::move(chunkResult));
+    }
+    return result;
+}
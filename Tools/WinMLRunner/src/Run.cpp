@@ -2,11 +2,21 @@
 #include "Common.h"
 #include "OutputHelper.h"
 #include "BindingUtilities.h"
+#include "InputFeatureCache.h"
+#include "ModelPrefetcher.h"
 #include <filesystem>
 #include <d3d11.h>
 #include <Windows.Graphics.DirectX.Direct3D11.interop.h>
 #include "Scenarios.h"
+#include "ThreadPool.h"
 #include <winrt/Windows.Foundation.Metadata.h>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <random>
+#include <thread>
 
 using namespace winrt::Windows::Graphics::DirectX::Direct3D11;
 using namespace winrt::Windows::Foundation::Metadata;
@@ -14,7 +24,8 @@ std::vector<ILearningModelFeatureValue> GenerateInputFeatures(const LearningMode
                                                               InputBindingType inputBindingType,
                                                               InputDataType inputDataType,
                                                               const LearningModelDeviceWithMetadata& device, uint32_t iterationNum,
-                                                              const std::wstring& imagePath)
+                                                              const std::wstring& imagePath,
+                                                              InputFeatureCache* inputFeatureCache)
 {
     std::vector<ILearningModelFeatureValue> inputFeatures;
     if (!imagePath.empty() && (!args.TerseOutput() || args.TerseOutput() && iterationNum == 0))
@@ -29,19 +40,29 @@ std::vector<ILearningModelFeatureValue> GenerateInputFeatures(const LearningMode
         {
             colorManagementMode = GetColorManagementMode(model);
         }
-        if (inputDataType == InputDataType::Tensor)
+        auto createFeature = [&]() -> ILearningModelFeatureValue {
+            if (inputDataType == InputDataType::Tensor)
+            {
+                // If CSV data is provided, then every input will contain the same CSV data
+                return BindingUtilities::CreateBindableTensor(description, imagePath, inputBindingType, inputDataType,
+                                                              args, iterationNum, colorManagementMode);
+            }
+            else
+            {
+                return BindingUtilities::CreateBindableImage(description, imagePath, inputBindingType, inputDataType,
+                                                             device.LearningModelDevice.Direct3D11Device(), args,
+                                                             iterationNum, colorManagementMode);
+            }
+        };
+        if (inputFeatureCache)
         {
-            // If CSV data is provided, then every input will contain the same CSV data
-            auto tensorFeature = BindingUtilities::CreateBindableTensor(description, imagePath, inputBindingType, inputDataType,
-                                                                        args, iterationNum, colorManagementMode);
-            inputFeatures.push_back(tensorFeature);
+            auto key = InputFeatureCache::MakeKey(args, description, imagePath, inputDataType, inputBindingType,
+                                                  iterationNum);
+            inputFeatures.push_back(inputFeatureCache->GetOrCreate(key, createFeature));
         }
         else
         {
-            auto imageFeature = BindingUtilities::CreateBindableImage(
-                description, imagePath, inputBindingType, inputDataType, device.LearningModelDevice.Direct3D11Device(),
-                args, iterationNum, colorManagementMode);
-            inputFeatures.push_back(imageFeature);
+            inputFeatures.push_back(createFeature());
         }
     }
 
@@ -51,7 +72,8 @@ std::vector<ILearningModelFeatureValue> GenerateInputFeatures(const LearningMode
 HRESULT BindInputFeatures(const LearningModel& model, const LearningModelBinding& context,
                           const std::vector<ILearningModelFeatureValue>& inputFeatures, const CommandLineArgs& args,
                           OutputHelper& output, bool capturePerf, uint32_t iterationNum,
-                          Profiler<WINML_MODEL_TEST_PERF>& profiler)
+                          Profiler<WINML_MODEL_TEST_PERF>& profiler,
+                          const std::vector<ITensor>* outputTensors = nullptr)
 {
     assert(model.InputFeatures().Size() == inputFeatures.size());
 
@@ -71,6 +93,17 @@ HRESULT BindInputFeatures(const LearningModel& model, const LearningModelBinding
             context.Bind(description.Name(), inputFeatures[i]);
         }
 
+        if (outputTensors)
+        {
+            for (uint32_t i = 0; i < model.OutputFeatures().Size(); i++)
+            {
+                if ((*outputTensors)[i])
+                {
+                    context.Bind(model.OutputFeatures().GetAt(i).Name(), (*outputTensors)[i]);
+                }
+            }
+        }
+
         if (capturePerf)
         {
             WINML_PROFILING_STOP(profiler, iterationNum == 0 ? WINML_MODEL_TEST_PERF::BIND_VALUE_FIRST_RUN
@@ -125,6 +158,38 @@ HRESULT LoadModel(LearningModel& model, const std::wstring& path, bool capturePe
     return S_OK;
 }
 
+// Counterpart of LoadModel for models that were loaded by the prefetcher. The measurements taken on the prefetching
+// thread are recorded under LOAD_MODEL.
+std::shared_ptr<PrefetchedModel> AcquirePrefetchedModel(ModelPrefetcher& modelPrefetcher, size_t modelIndex,
+                                                        const std::wstring& path, bool capturePerf,
+                                                        OutputHelper& output, const CommandLineArgs& args,
+                                                        uint32_t iterationNum,
+                                                        Profiler<WINML_MODEL_TEST_PERF>& profiler)
+{
+    std::shared_ptr<PrefetchedModel> prefetchedModel;
+    try
+    {
+        output.PrintLoadingInfo(path);
+        prefetchedModel = modelPrefetcher.Acquire(modelIndex);
+        if (capturePerf)
+        {
+            profiler[WINML_MODEL_TEST_PERF::LOAD_MODEL].Merge(prefetchedModel->LoadStatistics);
+            if (args.IsPerIterationCapture())
+            {
+                output.SaveLoadTimes(profiler, iterationNum);
+            }
+        }
+        output.PrintModelInfo(path, prefetchedModel->Model);
+    }
+    catch (hresult_error hr)
+    {
+        std::wcout << "Load Model: " << path << " [FAILED]" << std::endl;
+        std::wcout << hr.message().c_str() << std::endl;
+        throw;
+    }
+    return prefetchedModel;
+}
+
 void CreateSessionConsideringSupportForSessionOptions(LearningModelSession& session,
                                                       LearningModel& model,
                                                       Profiler<WINML_MODEL_TEST_PERF>& profiler,
@@ -193,10 +258,34 @@ HRESULT CreateSession(LearningModelSession& session,
     return S_OK;
 }
 
+// Hands out the session prefetched for the device, if there is one left, in place of CreateSession.
+bool TakePrefetchedSession(LearningModelSession& session, PrefetchedModel* prefetchedModel, size_t deviceIndex,
+                           const CommandLineArgs& args, Profiler<WINML_MODEL_TEST_PERF>& profiler)
+{
+    if (!prefetchedModel || deviceIndex >= prefetchedModel->Sessions.size() ||
+        prefetchedModel->Sessions[deviceIndex] == nullptr)
+    {
+        return false;
+    }
+    session = prefetchedModel->Sessions[deviceIndex];
+    prefetchedModel->Sessions[deviceIndex] = nullptr;
+    if (args.IsPerformanceCapture())
+    {
+        profiler[WINML_MODEL_TEST_PERF::CREATE_SESSION].Merge(*prefetchedModel->SessionStatistics[deviceIndex]);
+    }
+    if (args.IsEvaluationDebugOutputEnabled())
+    {
+        // Enables trace log output.
+        session.EvaluationProperties().Insert(L"EnableDebugOutput", nullptr);
+    }
+    return true;
+}
+
 HRESULT BindInputs(LearningModelBinding& context, const LearningModelSession& session,
                    OutputHelper& output, const LearningModelDeviceWithMetadata& device, const CommandLineArgs& args,
                    InputBindingType inputBindingType, InputDataType inputDataType, uint32_t iteration,
-                   Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath)
+                   Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath,
+                   InputFeatureCache* inputFeatureCache, const std::vector<ITensor>* outputTensors = nullptr)
 {
     if (device.DeviceType == DeviceType::CPU && inputDataType == InputDataType::Tensor &&
         inputBindingType == InputBindingType::GPU)
@@ -220,7 +309,8 @@ HRESULT BindInputs(LearningModelBinding& context, const LearningModelSession& se
     {
         try
         {
-            inputFeatures = GenerateInputFeatures(session.Model(), args, inputBindingType, inputDataType, device, iteration, imagePath);
+            inputFeatures = GenerateInputFeatures(session.Model(), args, inputBindingType, inputDataType, device,
+                                                  iteration, imagePath, inputFeatureCache);
         }
         catch (hresult_error hr)
         {
@@ -230,7 +320,8 @@ HRESULT BindInputs(LearningModelBinding& context, const LearningModelSession& se
         }
     }
     HRESULT bindInputResult =
-        BindInputFeatures(session.Model(), context, inputFeatures, args, output, captureIterationPerf, iteration, profiler);
+        BindInputFeatures(session.Model(), context, inputFeatures, args, output, captureIterationPerf, iteration, profiler,
+                          outputTensors);
 
     if (FAILED(bindInputResult))
     {
@@ -306,6 +397,84 @@ HRESULT CheckIfModelAndConfigurationsAreSupported(LearningModel& model, const st
     return S_OK;
 }
 
+HRESULT CheckIfBatchSizeIsSupported(const LearningModel& model, uint32_t batchSize, InputDataType inputDataType)
+{
+    if (batchSize > 1 && inputDataType != InputDataType::Tensor)
+    {
+        std::cout << "Batch size " << batchSize << " is only supported with tensor binding. Skipping." << std::endl;
+        return E_INVALIDARG;
+    }
+    for (auto&& description : model.InputFeatures())
+    {
+        auto tensorDescriptor = description.try_as<TensorFeatureDescriptor>();
+        if (!tensorDescriptor || tensorDescriptor.Shape().Size() == 0)
+        {
+            continue;
+        }
+        int64_t batchDimension = tensorDescriptor.Shape().GetAt(0);
+        if (batchDimension != -1 && batchDimension != batchSize)
+        {
+            std::wcout << L"Input " << description.Name().c_str() << L" has a fixed batch dimension of "
+                       << batchDimension << L". Skipping batch size " << batchSize << L"." << std::endl;
+            return E_INVALIDARG;
+        }
+    }
+    return S_OK;
+}
+
+// LearningModelSessionOptions can't be cloned, so every property the caller of run() may have set is copied. Sessions
+// of other batch sizes, including prefetched ones, are still created from the caller's options, so they can't be
+// changed in place.
+LearningModelSessionOptions CopySessionOptions(const LearningModelSessionOptions& sessionOptions)
+{
+    LearningModelSessionOptions copy;
+    copy.BatchSizeOverride(sessionOptions.BatchSizeOverride());
+    return copy;
+}
+
+HRESULT CreateBatchSessionOptions(uint32_t batchSize, LearningModelSessionOptions& sessionOptions)
+{
+    auto statics = get_activation_factory<ApiInformation, IApiInformationStatics>();
+    if (!statics.IsPropertyPresent(L"Windows.AI.MachineLearning.LearningModelSessionOptions", L"BatchSizeOverride"))
+    {
+        std::wcout << L"LearningModelSessionOptions.BatchSizeOverride isn't supported on this version of Windows. "
+                   << L"Skipping batch size " << batchSize << L"." << std::endl;
+        return E_NOTIMPL;
+    }
+    sessionOptions = CopySessionOptions(sessionOptions);
+    sessionOptions.BatchSizeOverride(batchSize);
+    return S_OK;
+}
+
+// A session only depends on the model, the device and the session options. Within one model/device pair the options
+// only change with the batch size, so sessions are cached per batch size and shared by every input configuration.
+using SessionCache = std::map<uint32_t, LearningModelSession>;
+
+HRESULT AcquireSession(SessionCache& sessionCache, LearningModelSession& session, LearningModel& model,
+                       PrefetchedModel* prefetchedModel, size_t deviceIndex,
+                       const LearningModelDeviceWithMetadata& learningModelDevice, CommandLineArgs& args,
+                       OutputHelper& output, Profiler<WINML_MODEL_TEST_PERF>& profiler,
+                       const LearningModelSessionOptions& sessionOptions)
+{
+    if (!args.IsRecreatingSession())
+    {
+        auto cachedSession = sessionCache.find(args.BatchSize());
+        if (cachedSession != sessionCache.end())
+        {
+            session = cachedSession->second;
+            return S_OK;
+        }
+    }
+    HRESULT hr = TakePrefetchedSession(session, prefetchedModel, deviceIndex, args, profiler)
+                     ? S_OK
+                     : CreateSession(session, model, learningModelDevice, args, output, profiler, sessionOptions);
+    if (SUCCEEDED(hr) && !args.IsRecreatingSession())
+    {
+        sessionCache.emplace(args.BatchSize(), session);
+    }
+    return hr;
+}
+
 HRESULT EvaluateModel(LearningModelEvaluationResult& result,
                       const LearningModelBinding& context, LearningModelSession& session, const CommandLineArgs& args,
                       OutputHelper& output, bool capturePerf, uint32_t iterationNum,
@@ -399,13 +568,88 @@ void PrintIfPIXToolAttached(OutputHelper& output)
 }
 #endif
 
+// Bound outputs are read back from the bound tensors, the evaluation result only holds the outputs WinML allocated.
+winrt::Windows::Foundation::Collections::IMapView<hstring, winrt::Windows::Foundation::IInspectable>
+GetEvaluationOutputs(const LearningModel& model, const LearningModelEvaluationResult& result,
+                     const std::vector<ITensor>* outputTensors)
+{
+    if (!outputTensors)
+    {
+        return result.Outputs();
+    }
+    auto outputs = single_threaded_map<hstring, winrt::Windows::Foundation::IInspectable>();
+    for (auto&& pair : result.Outputs())
+    {
+        outputs.Insert(pair.Key(), pair.Value());
+    }
+    for (uint32_t i = 0; i < model.OutputFeatures().Size(); i++)
+    {
+        if ((*outputTensors)[i])
+        {
+            outputs.Insert(model.OutputFeatures().GetAt(i).Name(), (*outputTensors)[i]);
+        }
+    }
+    return outputs.GetView();
+}
+
 void IterateBindAndEvaluate(const int maxBindAndEvalIterations, int& lastIteration, CommandLineArgs& args, OutputHelper& output,
                             LearningModelSession& session, HRESULT& lastHr,
                             const LearningModelDeviceWithMetadata& device, const InputBindingType inputBindingType,
                             const InputDataType inputDataType,
-                            Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath)
+                            Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath,
+                            InputFeatureCache* inputFeatureCache, SteadyStateDetector* steadyStateDetector = nullptr,
+                            bool bindOutputs = false)
 {
     Timer iterationTimer;
+
+    // Bound output tensors are allocated once and rebound every iteration, so every evaluation writes its results
+    // into the same buffers instead of allocating new ones.
+    std::vector<ITensor> outputTensors;
+    if (bindOutputs)
+    {
+        for (auto&& description : session.Model().OutputFeatures())
+        {
+            outputTensors.push_back(BindingUtilities::CreateBindableOutputTensor(description, args.BatchSize()));
+        }
+    }
+    const std::vector<ITensor>* boundOutputTensors = bindOutputs ? &outputTensors : nullptr;
+
+    // In pipelined mode the inputs of the next iterations are generated and bound on a worker thread while the
+    // current iteration is evaluating. Each in-flight iteration owns one binding of the ring, so a binding is only
+    // reused once the iteration that owned it has finished evaluating.
+    const bool isPipelined = args.IsPipelined() && (maxBindAndEvalIterations - lastIteration) > 1;
+    const uint32_t pipelineDepth = isPipelined ? args.PipelineDepth() : 1;
+    std::vector<LearningModelBinding> bindingRing;
+    std::deque<std::future<HRESULT>> pendingBinds;
+    std::atomic<bool> cancelPendingBinds = false;
+    // Declared last so that the worker is joined before the bindings and futures it references are destroyed.
+    std::unique_ptr<ThreadPool> bindWorker;
+    int nextIterationToBind = lastIteration;
+    auto submitBind = [&](int iteration) {
+        pendingBinds.push_back(bindWorker->SubmitWork([&, iteration]() -> HRESULT {
+            if (cancelPendingBinds)
+            {
+                return S_OK;
+            }
+            return BindInputs(bindingRing[iteration % pipelineDepth], session, output, device, args,
+                              inputBindingType, inputDataType, iteration, profiler, imagePath, inputFeatureCache,
+                              boundOutputTensors);
+        }));
+    };
+    if (isPipelined)
+    {
+        for (uint32_t i = 0; i < pipelineDepth; i++)
+        {
+            bindingRing.push_back(LearningModelBinding(session));
+        }
+        bindWorker = std::make_unique<ThreadPool>(1);
+        while (nextIterationToBind < maxBindAndEvalIterations &&
+               nextIterationToBind < lastIteration + static_cast<int>(pipelineDepth) - 1)
+        {
+            submitBind(nextIterationToBind++);
+        }
+    }
+
     for (; lastIteration < maxBindAndEvalIterations; lastIteration++)
     {
 #if defined(_AMD64_)
@@ -430,8 +674,25 @@ void IterateBindAndEvaluate(const int maxBindAndEvalIterations, int& lastIterati
                 break;
             }
         }
-        LearningModelBinding context(session);
-        lastHr = BindInputs(context, session, output, device, args, inputBindingType, inputDataType, lastIteration, profiler, imagePath);
+        LearningModelBinding context = nullptr;
+        if (isPipelined)
+        {
+            // The binding slot of the previous iteration is free again, keep the worker pipelineDepth - 1
+            // iterations ahead of the evaluation.
+            if (nextIterationToBind < maxBindAndEvalIterations)
+            {
+                submitBind(nextIterationToBind++);
+            }
+            lastHr = pendingBinds.front().get();
+            pendingBinds.pop_front();
+            context = bindingRing[lastIteration % pipelineDepth];
+        }
+        else
+        {
+            context = LearningModelBinding(session);
+            lastHr = BindInputs(context, session, output, device, args, inputBindingType, inputDataType, lastIteration,
+                                profiler, imagePath, inputFeatureCache, boundOutputTensors);
+        }
         if (FAILED(lastHr))
         {
             break;
@@ -453,7 +714,9 @@ void IterateBindAndEvaluate(const int maxBindAndEvalIterations, int& lastIterati
             // Only print eval results on the first iteration, iff it's not garbage data
             if (!args.IsGarbageInput() || args.IsSaveTensor())
             {
-                BindingUtilities::PrintOrSaveEvaluationResults(session.Model(), args, result.Outputs(), output, lastIteration);
+                BindingUtilities::PrintOrSaveEvaluationResults(
+                    session.Model(), args, GetEvaluationOutputs(session.Model(), result, boundOutputTensors), output,
+                    lastIteration);
             }
 
             if (args.TerseOutput() && args.NumIterations() > 1)
@@ -465,36 +728,452 @@ void IterateBindAndEvaluate(const int maxBindAndEvalIterations, int& lastIterati
 #if defined(_AMD64_)
         EndPIXCapture(output);
 #endif
+        if (steadyStateDetector && lastIteration > 0)
+        {
+            auto previousPhase = steadyStateDetector->GetPhase();
+            auto phase =
+                steadyStateDetector->AddSample(profiler[WINML_MODEL_TEST_PERF::EVAL_MODEL].GetClockTime());
+            if (previousPhase == SteadyStateDetector::Phase::WarmUp && phase != SteadyStateDetector::Phase::WarmUp)
+            {
+                // Only steady state iterations contribute to the reported bind and evaluate statistics
+                profiler.Reset(WINML_MODEL_TEST_PERF::BIND_VALUE, WINML_MODEL_TEST_PERF::BIND_VALUE_FIRST_RUN);
+            }
+            if (phase == SteadyStateDetector::Phase::Done)
+            {
+                lastIteration++;
+                break;
+            }
+        }
+    }
+    // Binds that were prepared ahead of an early exit are not evaluated, skip the ones that have not started yet.
+    cancelPendingBinds = true;
+}
+
+struct AsyncEvaluationResult
+{
+    double WallTime = 0; // in ms
+    LatencySummary Latency;
+
+    double CompletionsPerSecond() const { return WallTime > 0 ? Latency.GetCount() * 1000.0 / WallTime : 0; }
+};
+
+// Keeps up to args.AsyncDepth() EvaluateAsync calls in flight over a rotating set of bindings. The first iteration is
+// evaluated synchronously so that first run costs are reported as usual.
+void IterateAsyncBindAndEvaluate(int& lastIteration, CommandLineArgs& args, OutputHelper& output,
+                                 LearningModelSession& session, HRESULT& lastHr,
+                                 const LearningModelDeviceWithMetadata& device,
+                                 const InputBindingType inputBindingType, const InputDataType inputDataType,
+                                 Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath,
+                                 InputFeatureCache* inputFeatureCache, AsyncEvaluationResult& asyncResult)
+{
+    const uint32_t asyncDepth = args.AsyncDepth();
+    std::vector<LearningModelBinding> bindings;
+    for (uint32_t slot = 0; slot < asyncDepth; slot++)
+    {
+        LearningModelBinding binding(session);
+        lastHr = BindInputs(binding, session, output, device, args, inputBindingType, inputDataType, slot, profiler,
+                            imagePath, inputFeatureCache);
+        if (FAILED(lastHr))
+        {
+            return;
+        }
+        bindings.push_back(binding);
+    }
+
+    LearningModelEvaluationResult result = nullptr;
+    bool capturePerf = args.IsPerformanceCapture() || args.IsPerIterationCapture();
+    lastHr = EvaluateModel(result, bindings[0], session, args, output, capturePerf, 0, profiler);
+    if (FAILED(lastHr))
+    {
+        output.PrintEvaluatingInfo(1, device.DeviceType, inputBindingType, inputDataType,
+                                   device.DeviceCreationLocation, "[FAILED]");
+        return;
+    }
+    output.PrintEvaluatingInfo(1, device.DeviceType, inputBindingType, inputDataType, device.DeviceCreationLocation,
+                               "[SUCCESS]");
+    lastIteration = 1;
+
+    std::mutex stateMutex;
+    std::condition_variable slotFreed;
+    std::vector<uint32_t> freeSlots(asyncDepth);
+    std::iota(freeSlots.begin(), freeSlots.end(), 0);
+    uint32_t numSubmitted = 0;
+    uint32_t numCompleted = 0;
+    HRESULT asyncHr = S_OK;
+    std::vector<winrt::Windows::Foundation::IAsyncOperation<LearningModelEvaluationResult>> inFlight(asyncDepth);
+
+    Timer wallTimer;
+    wallTimer.Start();
+    for (uint32_t iteration = 1; iteration < args.NumIterations(); iteration++)
+    {
+        uint32_t slot;
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            slotFreed.wait(lock, [&] { return !freeSlots.empty() || FAILED(asyncHr); });
+            if (FAILED(asyncHr))
+            {
+                break;
+            }
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            numSubmitted++;
+        }
+
+        auto submitTime = std::chrono::steady_clock::now();
+        try
+        {
+            inFlight[slot] = session.EvaluateAsync(bindings[slot], L"");
+            inFlight[slot].Completed([&, slot, submitTime](auto&& operation, winrt::Windows::Foundation::AsyncStatus status) {
+                auto completeTime = std::chrono::steady_clock::now();
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (status == winrt::Windows::Foundation::AsyncStatus::Completed)
+                {
+                    double latency = std::chrono::duration<double, std::milli>(completeTime - submitTime).count();
+                    asyncResult.Latency.Record(latency);
+                    if (capturePerf)
+                    {
+                        // The evaluate statistics of the perf results are the submit to complete latencies
+                        profiler[WINML_MODEL_TEST_PERF::EVAL_MODEL].RecordTime(latency);
+                    }
+                }
+                else
+                {
+                    HRESULT errorCode = operation.ErrorCode();
+                    asyncHr = FAILED(errorCode) ? errorCode : E_FAIL;
+                }
+                freeSlots.push_back(slot);
+                numCompleted++;
+                slotFreed.notify_all();
+            });
+        }
+        catch (hresult_error hr)
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            asyncHr = hr.code();
+            freeSlots.push_back(slot);
+            numCompleted++;
+        }
+    }
+    {
+        // Drain the outstanding evaluations before the bindings go away.
+        std::unique_lock<std::mutex> lock(stateMutex);
+        slotFreed.wait(lock, [&] { return numCompleted == numSubmitted; });
+    }
+    asyncResult.WallTime = wallTimer.Stop();
+    lastIteration += static_cast<int>(asyncResult.Latency.GetCount());
+
+    lastHr = asyncHr;
+    if (FAILED(lastHr))
+    {
+        std::cout << "Asynchronous evaluation [FAILED]" << std::endl;
+        output.PrintEvaluatingInfo(lastIteration + 1, device.DeviceType, inputBindingType, inputDataType,
+                                   device.DeviceCreationLocation, "[FAILED]");
+        return;
+    }
+    printf("\nAsynchronous evaluation (queue depth = %u, evaluations = %zu):\n", asyncDepth,
+           asyncResult.Latency.GetCount());
+    std::cout << "  Completions: " << asyncResult.CompletionsPerSecond() << " /sec" << std::endl;
+    std::cout << "  Submit to complete latency: average " << asyncResult.Latency.GetAverage() << " ms, p50 "
+              << asyncResult.Latency.GetPercentile(50) << " ms, p90 " << asyncResult.Latency.GetPercentile(90)
+              << " ms, p99 " << asyncResult.Latency.GetPercentile(99) << " ms, max " << asyncResult.Latency.GetMax()
+              << " ms" << std::endl;
+}
+
+struct OpenLoopResult
+{
+    double WallTime = 0; // in ms
+    double Deadline = 0; // in ms
+    uint32_t NumMissedDeadlines = 0;
+    uint32_t NumLateDispatches = 0;
+    // Requests that were never evaluated because the bounded queue was full
+    size_t NumRejected = 0;
+    size_t NumDropped = 0;
+    size_t PeakQueueDepth = 0;
+    // Workers added and retired by the elastic pool of -MaxThreads, and the fraction of them that was busy
+    size_t NumGrows = 0;
+    size_t NumShrinks = 0;
+    unsigned int PeakWorkers = 0;
+    double Utilization = 0;
+    // Collected with -ThreadPoolStats
+    ThreadPoolStatistics PoolStatistics;
+    LatencySummary Latency;
+
+    double CompletionsPerSecond() const { return WallTime > 0 ? Latency.GetCount() * 1000.0 / WallTime : 0; }
+};
+
+// Sleeps until shortly before the deadline and yields for the remainder, because sleeps alone are only as precise as
+// the system timer resolution.
+void WaitUntil(const std::chrono::steady_clock::time_point& deadline)
+{
+    const auto spinThreshold = std::chrono::milliseconds(2);
+    for (auto now = std::chrono::steady_clock::now(); now < deadline; now = std::chrono::steady_clock::now())
+    {
+        if (deadline - now > spinThreshold)
+        {
+            std::this_thread::sleep_for(deadline - now - spinThreshold);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Issues evaluations at args.OpenLoopRate() requests per second from this thread, independently of how fast earlier
+// requests complete, on a pool of args.NumThreads() workers. Latency is measured from the time a request was supposed
+// to start, so queueing behind a slow evaluation or a late dispatch is part of the reported latency. With
+// args.MaxThreads() the pool grows up to that many workers while requests queue behind busy workers.
+void IterateOpenLoopBindAndEvaluate(int& lastIteration, CommandLineArgs& args, OutputHelper& output,
+                                    LearningModelSession& session, HRESULT& lastHr,
+                                    const LearningModelDeviceWithMetadata& device,
+                                    const InputBindingType inputBindingType, const InputDataType inputDataType,
+                                    Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath,
+                                    InputFeatureCache* inputFeatureCache, OpenLoopResult& openLoopResult)
+{
+    using Clock = std::chrono::steady_clock;
+    const uint32_t numWorkers = args.NumThreads();
+    const uint32_t maxWorkers = (std::max)(numWorkers, args.MaxThreads());
+    std::vector<LearningModelBinding> bindings;
+    for (uint32_t worker = 0; worker < maxWorkers; worker++)
+    {
+        LearningModelBinding binding(session);
+        lastHr = BindInputs(binding, session, output, device, args, inputBindingType, inputDataType, worker, profiler,
+                            imagePath, inputFeatureCache);
+        if (FAILED(lastHr))
+        {
+            return;
+        }
+        bindings.push_back(binding);
+    }
+
+    LearningModelEvaluationResult result = nullptr;
+    bool capturePerf = args.IsPerformanceCapture() || args.IsPerIterationCapture();
+    lastHr = EvaluateModel(result, bindings[0], session, args, output, capturePerf, 0, profiler);
+    if (FAILED(lastHr))
+    {
+        output.PrintEvaluatingInfo(1, device.DeviceType, inputBindingType, inputDataType,
+                                   device.DeviceCreationLocation, "[FAILED]");
+        return;
+    }
+    output.PrintEvaluatingInfo(1, device.DeviceType, inputBindingType, inputDataType, device.DeviceCreationLocation,
+                               "[SUCCESS]");
+    lastIteration = 1;
+
+    // A request misses its deadline when it completes later than one mean inter-arrival time after its intended start.
+    const double periodMilliseconds = 1000.0 / args.OpenLoopRate();
+    openLoopResult.Deadline = periodMilliseconds;
+    // Fixed seed so that Poisson arrival schedules are identical between runs.
+    std::mt19937 arrivalGenerator(0);
+    std::exponential_distribution<double> interArrivalMilliseconds(1.0 / periodMilliseconds);
+
+    std::mutex stateMutex;
+    std::vector<uint32_t> freeBindings(maxWorkers);
+    std::iota(freeBindings.begin(), freeBindings.end(), 0);
+    HRESULT openLoopHr = S_OK;
+
+    auto start = Clock::now();
+    {
+        // The pool is joined at the end of this scope, after the last request has completed.
+        ThreadPool pool(numWorkers, args.MaxQueueDepth(), args.MaxQueueDepthPolicy(), args.WorkerThreadPlacement());
+        if (maxWorkers > numWorkers)
+        {
+            // Grows once a request has waited for a quarter of the inter-arrival time
+            auto growAfter = std::chrono::milliseconds(static_cast<long long>(periodMilliseconds / 4));
+            pool.SetElastic(maxWorkers, (std::max)(growAfter, std::chrono::milliseconds(1)));
+        }
+        if (args.IsThreadPoolStats())
+        {
+            pool.EnableStatistics();
+        }
+        auto intendedStart = start;
+        for (uint32_t iteration = 1; iteration < args.NumIterations(); iteration++)
+        {
+            if (iteration > 1)
+            {
+                double interArrival = args.OpenLoopArrivalProcess() == ArrivalProcess::Poisson
+                                          ? interArrivalMilliseconds(arrivalGenerator)
+                                          : periodMilliseconds;
+                intendedStart += std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double, std::milli>(interArrival));
+            }
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (FAILED(openLoopHr))
+                {
+                    break;
+                }
+            }
+            if (Clock::now() > intendedStart)
+            {
+                openLoopResult.NumLateDispatches++;
+            }
+            else
+            {
+                WaitUntil(intendedStart);
+            }
+
+            pool.SubmitWork([&, intendedStart]() {
+                uint32_t binding;
+                {
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    binding = freeBindings.back();
+                    freeBindings.pop_back();
+                }
+                HRESULT hr = S_OK;
+                Timer evaluateTimer;
+                evaluateTimer.Start();
+                try
+                {
+                    session.Evaluate(bindings[binding], L"");
+                }
+                catch (hresult_error error)
+                {
+                    hr = error.code();
+                }
+                double evaluateTime = evaluateTimer.Stop();
+                double latency = std::chrono::duration<double, std::milli>(Clock::now() - intendedStart).count();
+
+                std::lock_guard<std::mutex> lock(stateMutex);
+                freeBindings.push_back(binding);
+                if (FAILED(hr))
+                {
+                    openLoopHr = hr;
+                    return;
+                }
+                openLoopResult.Latency.Record(latency);
+                if (capturePerf)
+                {
+                    // How long the evaluation itself took, without queueing, for the evaluate statistics
+                    profiler[WINML_MODEL_TEST_PERF::EVAL_MODEL].RecordTime(evaluateTime);
+                }
+                if (latency > periodMilliseconds)
+                {
+                    openLoopResult.NumMissedDeadlines++;
+                }
+            });
+        }
+        openLoopResult.NumRejected = pool.RejectedTasks();
+        openLoopResult.NumDropped = pool.DroppedTasks();
+        openLoopResult.PeakQueueDepth = pool.PeakQueueDepth();
+        openLoopResult.PeakWorkers = numWorkers;
+        for (const ThreadPoolResizeEvent& resize : pool.ResizeEvents())
+        {
+            (resize.NewSize > resize.OldSize ? openLoopResult.NumGrows : openLoopResult.NumShrinks)++;
+            openLoopResult.PeakWorkers = (std::max)(openLoopResult.PeakWorkers, resize.NewSize);
+        }
+        openLoopResult.Utilization = pool.Utilization();
+        if (args.IsThreadPoolStats())
+        {
+            // Waits for the requests still running so that their times are counted
+            pool.Shutdown();
+            openLoopResult.PoolStatistics = pool.Statistics();
+        }
+    }
+    openLoopResult.WallTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    lastIteration += static_cast<int>(openLoopResult.Latency.GetCount());
+
+    lastHr = openLoopHr;
+    if (FAILED(lastHr))
+    {
+        std::cout << "Open loop evaluation [FAILED]" << std::endl;
+        output.PrintEvaluatingInfo(lastIteration + 1, device.DeviceType, inputBindingType, inputDataType,
+                                   device.DeviceCreationLocation, "[FAILED]");
+        return;
+    }
+    printf("\nOpen loop evaluation (target rate = %g/sec, arrivals = %s, workers = %u, requests = %zu):\n",
+           args.OpenLoopRate(), args.OpenLoopArrivalProcess() == ArrivalProcess::Poisson ? "Poisson" : "Constant",
+           numWorkers, openLoopResult.Latency.GetCount());
+    std::cout << "  Achieved rate: " << openLoopResult.CompletionsPerSecond() << " /sec" << std::endl;
+    std::cout << "  Latency from intended start: average " << openLoopResult.Latency.GetAverage() << " ms, p50 "
+              << openLoopResult.Latency.GetPercentile(50) << " ms, p90 " << openLoopResult.Latency.GetPercentile(90)
+              << " ms, p99 " << openLoopResult.Latency.GetPercentile(99) << " ms, p99.9 "
+              << openLoopResult.Latency.GetPercentile(99.9) << " ms, max " << openLoopResult.Latency.GetMax() << " ms"
+              << std::endl;
+    std::cout << "  Missed deadlines (" << periodMilliseconds << " ms): " << openLoopResult.NumMissedDeadlines
+              << std::endl;
+    std::cout << "  Late dispatches: " << openLoopResult.NumLateDispatches << std::endl;
+    std::cout << "  Peak queue depth: " << openLoopResult.PeakQueueDepth << std::endl;
+    if (args.IsBoundedQueue())
+    {
+        std::cout << "  Rejected requests: " << openLoopResult.NumRejected
+                  << ", dropped requests: " << openLoopResult.NumDropped << std::endl;
+    }
+    if (maxWorkers > numWorkers)
+    {
+        std::cout << "  Workers: peak " << openLoopResult.PeakWorkers << " of " << maxWorkers << ", grew "
+                  << openLoopResult.NumGrows << " times, shrank " << openLoopResult.NumShrinks
+                  << " times, utilization " << openLoopResult.Utilization * 100 << "%" << std::endl;
+    }
+    if (args.IsThreadPoolStats())
+    {
+        const ThreadPoolStatistics& statistics = openLoopResult.PoolStatistics;
+        auto printHistogram = [](const char* name, const Histogram& histogram) {
+            std::cout << "  Pool " << name << ": average " << histogram.GetAverage() << " us, p50 "
+                      << histogram.GetPercentile(50) << " us, p90 " << histogram.GetPercentile(90) << " us, p99 "
+                      << histogram.GetPercentile(99) << " us, max " << histogram.GetMax() << " us" << std::endl;
+        };
+        printHistogram("queue wait", statistics.QueueWait);
+        printHistogram("run time", statistics.RunTime);
+        printHistogram("lock wait", statistics.LockWait);
+        printHistogram("lock hold", statistics.LockHold);
+        std::cout << "  Pool queue length at submission: average " << statistics.QueueLength.GetAverage() << ", p99 "
+                  << statistics.QueueLength.GetPercentile(99) << ", max " << statistics.QueueLength.GetMax()
+                  << std::endl;
+        std::cout << "  Pool workers busy " << statistics.BusyRatio() * 100 << "% of the time" << std::endl;
     }
 }
 
 void RunBindAndEvaluateOnce(CommandLineArgs& args, OutputHelper& output, LearningModelSession& session,
                             HRESULT& lastHr, const LearningModelDeviceWithMetadata& device,
                             const InputBindingType inputBindingType, const InputDataType inputDataType,
-                            Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath)
+                            Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& imagePath,
+                            InputFeatureCache* inputFeatureCache)
 {
     int lastIteration = 0;
     IterateBindAndEvaluate(1, lastIteration, args, output, session, lastHr, device, inputBindingType, inputDataType,
-                           profiler, imagePath);
+                           profiler, imagePath, inputFeatureCache);
 }
 
 void WritePerfResults(CommandLineArgs& args, OutputHelper& output, LearningModelSession& session,
                       const LearningModelDeviceWithMetadata& device, const InputBindingType inputBindingType,
                       const InputDataType inputDataType, Profiler<WINML_MODEL_TEST_PERF>& profiler,
                       const std::wstring& modelPath, const std::wstring& imagePath,
-                      const uint32_t sessionCreationIteration, const int lastIteration)
+                      const uint32_t sessionCreationIteration, const int lastIteration,
+                      const std::vector<std::pair<std::string, std::string>>& extraPerfFileMetadata = {})
 {
     output.PrintResults(profiler, lastIteration, device.DeviceType, inputBindingType, inputDataType, device.DeviceCreationLocation,
                         args.IsPerformanceConsoleOutputVerbose());
+    // Evaluate times above are per batch
+    double averageEvalTimePerSample = profiler[WINML_MODEL_TEST_PERF::EVAL_MODEL].GetAverage(CounterType::TIMER) /
+                                      args.BatchSize();
+    double samplesPerSecond = averageEvalTimePerSample > 0 ? 1000.0 / averageEvalTimePerSample : 0;
+    if (args.IsBatchSizeSweep())
+    {
+        std::cout << "  Batch size: " << args.BatchSize() << ", average evaluate time per sample: "
+                  << averageEvalTimePerSample << " ms, " << samplesPerSecond << " samples/sec" << std::endl;
+    }
     if (args.IsOutputPerf())
     {
         std::string deviceTypeStringified = TypeHelper::Stringify(device.DeviceType);
         std::string inputDataTypeStringified = TypeHelper::Stringify(inputDataType);
         std::string inputBindingTypeStringified = TypeHelper::Stringify(inputBindingType);
         std::string deviceCreationLocationStringified = TypeHelper::Stringify(device.DeviceCreationLocation);
+        auto perfFileMetadata = args.GetPerformanceFileMetadata();
+        if (args.IsBatchSizeSweep())
+        {
+            perfFileMetadata.push_back({ "batch size", std::to_string(args.BatchSize()) });
+            perfFileMetadata.push_back(
+                { "average evaluate time per sample (ms)", std::to_string(averageEvalTimePerSample) });
+            perfFileMetadata.push_back({ "samples/sec", std::to_string(samplesPerSecond) });
+        }
+        const ProfilingOverhead& overhead = profiler.GetOverhead();
+        perfFileMetadata.push_back({ "profiler counters", args.IsPerfTimingOnly() ? "timing only" : "all" });
+        perfFileMetadata.push_back({ "profiler overhead per measurement (ms)", std::to_string(overhead.Call) });
+        perfFileMetadata.push_back({ "profiler overhead subtracted (ms)", std::to_string(overhead.Interval) });
+        perfFileMetadata.insert(perfFileMetadata.end(), extraPerfFileMetadata.begin(), extraPerfFileMetadata.end());
         output.WritePerformanceDataToCSV(profiler, lastIteration, modelPath, deviceTypeStringified,
                                             inputDataTypeStringified, inputBindingTypeStringified,
-                                            deviceCreationLocationStringified, args.GetPerformanceFileMetadata());
+                                            deviceCreationLocationStringified, perfFileMetadata);
     }
     if (args.IsPerIterationCapture())
     {
@@ -505,25 +1184,540 @@ void WritePerfResults(CommandLineArgs& args, OutputHelper& output, LearningModel
 void RunConfiguration(CommandLineArgs& args, OutputHelper& output, LearningModelSession& session, HRESULT& lastHr,
                       const InputBindingType inputBindingType, const InputDataType inputDataType,
                       Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& modelPath,
-                      const std::wstring& imagePath, const uint32_t sessionCreationIteration, const LearningModelDeviceWithMetadata& device)
+                      const std::wstring& imagePath, const uint32_t sessionCreationIteration, const LearningModelDeviceWithMetadata& device,
+                      InputFeatureCache* inputFeatureCache)
 {
     if (sessionCreationIteration < args.NumSessionCreationIterations() - 1)
     {
-        RunBindAndEvaluateOnce(args, output, session, lastHr, device, inputBindingType, inputDataType, profiler, imagePath);
+        RunBindAndEvaluateOnce(args, output, session, lastHr, device, inputBindingType, inputDataType, profiler, imagePath,
+                               inputFeatureCache);
         return;
     }
-    else
+    else if (args.IsAsyncEvaluation())
+    {
+        int lastIteration = 0;
+        AsyncEvaluationResult asyncResult;
+        IterateAsyncBindAndEvaluate(lastIteration, args, output, session, lastHr, device, inputBindingType,
+                                    inputDataType, profiler, imagePath, inputFeatureCache, asyncResult);
+        if (args.IsPerformanceCapture() && SUCCEEDED(lastHr))
+        {
+            std::vector<std::pair<std::string, std::string>> asyncMetadata = {
+                { "async depth", std::to_string(args.AsyncDepth()) },
+                { "async completions/sec", std::to_string(asyncResult.CompletionsPerSecond()) },
+                { "async average latency (ms)", std::to_string(asyncResult.Latency.GetAverage()) },
+                { "async p50 latency (ms)", std::to_string(asyncResult.Latency.GetPercentile(50)) },
+                { "async p90 latency (ms)", std::to_string(asyncResult.Latency.GetPercentile(90)) },
+                { "async p99 latency (ms)", std::to_string(asyncResult.Latency.GetPercentile(99)) },
+                { "async max latency (ms)", std::to_string(asyncResult.Latency.GetMax()) }
+            };
+            WritePerfResults(args, output, session, device, inputBindingType, inputDataType, profiler, modelPath,
+                             imagePath, sessionCreationIteration, lastIteration, asyncMetadata);
+        }
+    }
+    else if (args.IsOpenLoop())
     {
         int lastIteration = 0;
-        IterateBindAndEvaluate(args.NumIterations(), lastIteration, args, output, session, lastHr, device,
-                               inputBindingType, inputDataType, profiler, imagePath);
+        OpenLoopResult openLoopResult;
+        IterateOpenLoopBindAndEvaluate(lastIteration, args, output, session, lastHr, device, inputBindingType,
+                                       inputDataType, profiler, imagePath, inputFeatureCache, openLoopResult);
         if (args.IsPerformanceCapture() && SUCCEEDED(lastHr))
         {
+            std::vector<std::pair<std::string, std::string>> openLoopMetadata = {
+                { "open loop target rate (/sec)", std::to_string(args.OpenLoopRate()) },
+                { "open loop arrivals",
+                  args.OpenLoopArrivalProcess() == ArrivalProcess::Poisson ? "Poisson" : "Constant" },
+                { "open loop achieved rate (/sec)", std::to_string(openLoopResult.CompletionsPerSecond()) },
+                { "open loop average latency (ms)", std::to_string(openLoopResult.Latency.GetAverage()) },
+                { "open loop p50 latency (ms)", std::to_string(openLoopResult.Latency.GetPercentile(50)) },
+                { "open loop p90 latency (ms)", std::to_string(openLoopResult.Latency.GetPercentile(90)) },
+                { "open loop p99 latency (ms)", std::to_string(openLoopResult.Latency.GetPercentile(99)) },
+                { "open loop p99.9 latency (ms)", std::to_string(openLoopResult.Latency.GetPercentile(99.9)) },
+                { "open loop max latency (ms)", std::to_string(openLoopResult.Latency.GetMax()) },
+                { "open loop deadline (ms)", std::to_string(openLoopResult.Deadline) },
+                { "open loop missed deadlines", std::to_string(openLoopResult.NumMissedDeadlines) },
+                { "open loop late dispatches", std::to_string(openLoopResult.NumLateDispatches) },
+                { "open loop peak queue depth", std::to_string(openLoopResult.PeakQueueDepth) }
+            };
+            if (args.IsBoundedQueue())
+            {
+                openLoopMetadata.push_back({ "open loop max queue depth", std::to_string(args.MaxQueueDepth()) });
+                openLoopMetadata.push_back(
+                    { "open loop rejected requests", std::to_string(openLoopResult.NumRejected) });
+                openLoopMetadata.push_back({ "open loop dropped requests", std::to_string(openLoopResult.NumDropped) });
+            }
+            if (args.MaxThreads() > args.NumThreads())
+            {
+                openLoopMetadata.push_back({ "open loop max workers", std::to_string(args.MaxThreads()) });
+                openLoopMetadata.push_back({ "open loop peak workers", std::to_string(openLoopResult.PeakWorkers) });
+                openLoopMetadata.push_back(
+                    { "open loop worker utilization", std::to_string(openLoopResult.Utilization) });
+            }
+            if (args.IsThreadPoolStats())
+            {
+                const ThreadPoolStatistics& statistics = openLoopResult.PoolStatistics;
+                const std::pair<const char*, const Histogram*> histograms[] = {
+                    { "queue wait", &statistics.QueueWait },
+                    { "run time", &statistics.RunTime },
+                    { "lock wait", &statistics.LockWait },
+                    { "lock hold", &statistics.LockHold }
+                };
+                for (const auto& histogram : histograms)
+                {
+                    std::string name = std::string("pool ") + histogram.first;
+                    const Histogram& values = *histogram.second;
+                    openLoopMetadata.push_back({ name + " average (us)", std::to_string(values.GetAverage()) });
+                    openLoopMetadata.push_back({ name + " p50 (us)", std::to_string(values.GetPercentile(50)) });
+                    openLoopMetadata.push_back({ name + " p90 (us)", std::to_string(values.GetPercentile(90)) });
+                    openLoopMetadata.push_back({ name + " p99 (us)", std::to_string(values.GetPercentile(99)) });
+                    openLoopMetadata.push_back({ name + " max (us)", std::to_string(values.GetMax()) });
+                }
+                openLoopMetadata.push_back(
+                    { "pool average queue length", std::to_string(statistics.QueueLength.GetAverage()) });
+                openLoopMetadata.push_back(
+                    { "pool max queue length", std::to_string(statistics.QueueLength.GetMax()) });
+                openLoopMetadata.push_back({ "pool busy ratio", std::to_string(statistics.BusyRatio()) });
+            }
             WritePerfResults(args, output, session, device, inputBindingType, inputDataType, profiler, modelPath,
-                             imagePath, sessionCreationIteration, lastIteration);
+                             imagePath, sessionCreationIteration, lastIteration, openLoopMetadata);
+        }
+    }
+    else
+    {
+        // -BindOutputs evaluates the configuration once more with bound outputs so both runs are reported side by side.
+        // The second run always finds the session warm, so the order alternates between neighbouring configurations
+        // to keep the comparison from consistently favouring one of the modes. It only depends on the configuration,
+        // so a configuration is evaluated in the same order regardless of the models and devices run before it.
+        std::vector<bool> outputBindingModes = { false };
+        if (args.IsBindingOutputs())
+        {
+            const bool boundFirst = (static_cast<uint32_t>(inputBindingType) + static_cast<uint32_t>(inputDataType) +
+                                     args.BatchSize() + sessionCreationIteration) % 2 == 0;
+            outputBindingModes = { boundFirst, !boundFirst };
+        }
+        for (size_t mode = 0; mode < outputBindingModes.size(); mode++)
+        {
+            const bool bindOutputs = outputBindingModes[mode];
+            if (mode > 0 && (args.IsPerformanceCapture() || args.IsPerIterationCapture()))
+            {
+                profiler.Reset(WINML_MODEL_TEST_PERF::BIND_VALUE, WINML_MODEL_TEST_PERF::COUNT);
+            }
+            int lastIteration = 0;
+            std::unique_ptr<SteadyStateDetector> steadyStateDetector;
+            if (args.IsAdaptiveIterations() && args.NumIterations() > 1)
+            {
+                // The first iteration is reported separately and doesn't count towards warm-up
+                steadyStateDetector = std::make_unique<SteadyStateDetector>(
+                    args.WarmupCV(), args.TargetRelativeError(),
+                    args.AdaptiveIterationsStatistic() == AdaptiveStatistic::Median
+                        ? SteadyStateDetector::Statistic::Median
+                        : SteadyStateDetector::Statistic::Mean,
+                    args.NumIterations() - 1);
+            }
+            IterateBindAndEvaluate(args.NumIterations(), lastIteration, args, output, session, lastHr, device,
+                                   inputBindingType, inputDataType, profiler, imagePath, inputFeatureCache,
+                                   steadyStateDetector.get(), bindOutputs);
+            if (args.IsPerformanceCapture() && SUCCEEDED(lastHr))
+            {
+                std::vector<std::pair<std::string, std::string>> perfFileMetadata;
+                if (steadyStateDetector)
+                {
+                    std::string statistic =
+                        steadyStateDetector->GetStatistic() == SteadyStateDetector::Statistic::Median ? "median"
+                                                                                                      : "mean";
+                    printf("\nAdaptive iterations:\n");
+                    printf("  Warm-up: %zu iterations (%s, window CV = %f)\n",
+                           steadyStateDetector->GetWarmupIterations(),
+                           steadyStateDetector->IsWarmupConverged() ? "converged" : "did not converge",
+                           steadyStateDetector->GetWindowCV());
+                    printf("  Steady state: %zu iterations, %s = %f ms +/- %.2f%% (%s)\n",
+                           steadyStateDetector->GetMeasuredIterations(), statistic.c_str(),
+                           steadyStateDetector->GetEstimate(), steadyStateDetector->GetRelativeError() * 100,
+                           steadyStateDetector->IsMeasurementConverged() ? "converged" : "did not converge");
+                    perfFileMetadata = {
+                        { "warm-up iterations", std::to_string(steadyStateDetector->GetWarmupIterations()) },
+                        { "warm-up converged", steadyStateDetector->IsWarmupConverged() ? "true" : "false" },
+                        { "warm-up window CV", std::to_string(steadyStateDetector->GetWindowCV()) },
+                        { "steady state iterations", std::to_string(steadyStateDetector->GetMeasuredIterations()) },
+                        { "steady state statistic", statistic },
+                        { "steady state evaluate time (ms)", std::to_string(steadyStateDetector->GetEstimate()) },
+                        { "steady state relative error", std::to_string(steadyStateDetector->GetRelativeError()) },
+                        { "steady state converged",
+                          steadyStateDetector->IsMeasurementConverged() ? "true" : "false" }
+                    };
+                }
+                if (args.IsBindingOutputs())
+                {
+                    perfFileMetadata.push_back({ "bound outputs", bindOutputs ? "true" : "false" });
+                }
+                WritePerfResults(args, output, session, device, inputBindingType, inputDataType, profiler, modelPath,
+                                 imagePath, sessionCreationIteration, lastIteration, perfFileMetadata);
+            }
         }
     }
 }
+struct ThroughputResult
+{
+    double WallTime = 0; // in ms
+    uint32_t NumInferences = 0;
+    std::vector<LatencySummary> WorkerLatencies;
+    LatencySummary Latency;
+
+    double InferencesPerSecond() const { return WallTime > 0 ? NumInferences * 1000.0 / WallTime : 0; }
+};
+
+// Evaluates numSessions sessions of the model with threadsPerSession workers each. Every worker owns its binding and
+// evaluates args.NumIterations() times once all workers have been set up.
+HRESULT MeasureThroughput(ThroughputResult& result, uint32_t numSessions, uint32_t threadsPerSession,
+                          LearningModel& model, const LearningModelDeviceWithMetadata& device, CommandLineArgs& args,
+                          OutputHelper& output, const InputBindingType inputBindingType,
+                          const InputDataType inputDataType, Profiler<WINML_MODEL_TEST_PERF>& profiler,
+                          const std::wstring& imagePath, const LearningModelSessionOptions& sessionOptions,
+                          InputFeatureCache* inputFeatureCache)
+{
+    const uint32_t numWorkers = numSessions * threadsPerSession;
+    const uint32_t numIterations = args.NumIterations();
+    std::vector<LearningModelSession> sessions;
+    std::vector<LearningModelBinding> bindings;
+    for (uint32_t i = 0; i < numSessions; i++)
+    {
+        LearningModelSession session = nullptr;
+        HRESULT hr = CreateSession(session, model, device, args, output, profiler, sessionOptions);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        sessions.push_back(session);
+    }
+    for (uint32_t worker = 0; worker < numWorkers; worker++)
+    {
+        auto& session = sessions[worker / threadsPerSession];
+        LearningModelBinding binding(session);
+        HRESULT hr = BindInputs(binding, session, output, device, args, inputBindingType, inputDataType, worker,
+                                profiler, imagePath, inputFeatureCache);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+        bindings.push_back(binding);
+    }
+
+    try
+    {
+        // Warm up every session so that first run costs are not attributed to the measured window.
+        for (uint32_t i = 0; i < numSessions; i++)
+        {
+            sessions[i].Evaluate(bindings[i * threadsPerSession], L"");
+        }
+    }
+    catch (hresult_error hr)
+    {
+        std::cout << "Warm up evaluation [FAILED]" << std::endl;
+        std::wcout << hr.message().c_str() << std::endl;
+        return hr.code();
+    }
+
+    // Workers wait on the start gate so that thread creation is not part of the measured window.
+    std::promise<void> startGate;
+    std::shared_future<void> start = startGate.get_future().share();
+    std::vector<std::future<LatencySummary>> workerResults;
+    // Declared after the sessions and bindings so that the workers are joined before those are destroyed.
+    ThreadPool pool(numWorkers, 0, QueueFullPolicy::Block, args.WorkerThreadPlacement());
+    for (uint32_t worker = 0; worker < numWorkers; worker++)
+    {
+        workerResults.push_back(pool.SubmitWork([&, worker, start]() {
+            auto& session = sessions[worker / threadsPerSession];
+            LatencySummary latencies;
+            Timer timer;
+            start.wait();
+            for (uint32_t i = 0; i < numIterations; i++)
+            {
+                timer.Start();
+                session.Evaluate(bindings[worker], L"");
+                latencies.Record(timer.Stop());
+            }
+            return latencies;
+        }));
+    }
+
+    Timer wallTimer;
+    wallTimer.Start();
+    startGate.set_value();
+    HRESULT lastHr = S_OK;
+    for (uint32_t worker = 0; worker < numWorkers; worker++)
+    {
+        uint32_t sessionIndex = worker / threadsPerSession;
+        try
+        {
+            result.WorkerLatencies.emplace_back(workerResults[worker].get());
+            result.Latency.Merge(result.WorkerLatencies.back());
+        }
+        catch (hresult_error hr)
+        {
+            std::cout << "Throughput evaluation of session " << sessionIndex << " [FAILED]" << std::endl;
+            std::wcout << hr.message().c_str() << std::endl;
+            lastHr = hr.code();
+        }
+        catch (const std::exception& error)
+        {
+            std::cout << "Throughput evaluation of session " << sessionIndex << " [FAILED]" << std::endl;
+            std::cout << error.what() << std::endl;
+            lastHr = E_FAIL;
+        }
+        catch (...)
+        {
+            std::cout << "Throughput evaluation of session " << sessionIndex << " [FAILED]" << std::endl;
+            lastHr = E_FAIL;
+        }
+    }
+    result.WallTime = wallTimer.Stop();
+    result.NumInferences = static_cast<uint32_t>(result.Latency.GetCount());
+
+    for (auto& session : sessions)
+    {
+        session.Close();
+    }
+    return lastHr;
+}
+
+void RunThroughputConfiguration(CommandLineArgs& args, OutputHelper& output, LearningModel& model, HRESULT& lastHr,
+                                const InputBindingType inputBindingType, const InputDataType inputDataType,
+                                Profiler<WINML_MODEL_TEST_PERF>& profiler, const std::wstring& modelPath,
+                                const std::wstring& imagePath, const LearningModelDeviceWithMetadata& device,
+                                const LearningModelSessionOptions& sessionOptions,
+                                InputFeatureCache* inputFeatureCache)
+{
+    // The workers time their own evaluations, the shared profiler is not safe to use from several threads.
+    CommandLineArgs workerArgs = args;
+    workerArgs.TogglePerformanceCapture(false);
+    workerArgs.TogglePerIterationPerformanceCapture(false);
+
+    const uint32_t numSessions = args.ThroughputSessions();
+    const uint32_t threadsPerSession = args.ThroughputThreadsPerSession();
+    ThroughputResult baseline;
+    lastHr = MeasureThroughput(baseline, 1, 1, model, device, workerArgs, output, inputBindingType, inputDataType,
+                               profiler, imagePath, sessionOptions, inputFeatureCache);
+    if (FAILED(lastHr))
+    {
+        return;
+    }
+    ThroughputResult scaled;
+    lastHr = MeasureThroughput(scaled, numSessions, threadsPerSession, model, device, workerArgs, output,
+                               inputBindingType, inputDataType, profiler, imagePath, sessionOptions,
+                               inputFeatureCache);
+    if (FAILED(lastHr))
+    {
+        return;
+    }
+
+    double scalingEfficiency =
+        baseline.InferencesPerSecond() > 0
+            ? scaled.InferencesPerSecond() / (baseline.InferencesPerSecond() * numSessions * threadsPerSession)
+            : 0;
+
+    printf("\nThroughput (device = %s, sessions = %u, threads per session = %u, iterations per thread = %u, "
+           "inputBinding = %s, inputDataType = %s, deviceCreationLocation = %s):\n",
+           TypeHelper::Stringify(device.DeviceType).c_str(), numSessions, threadsPerSession, args.NumIterations(),
+           TypeHelper::Stringify(inputBindingType).c_str(), TypeHelper::Stringify(inputDataType).c_str(),
+           TypeHelper::Stringify(device.DeviceCreationLocation).c_str());
+    std::cout << "  Baseline (1 session, 1 thread): " << baseline.InferencesPerSecond() << " inferences/sec"
+              << std::endl;
+    std::cout << "  Aggregate: " << scaled.InferencesPerSecond() << " inferences/sec" << std::endl;
+    std::cout << "  Scaling efficiency: " << scalingEfficiency * 100 << " %" << std::endl;
+    std::cout << "  Latency: average " << scaled.Latency.GetAverage() << " ms, p50 "
+              << scaled.Latency.GetPercentile(50) << " ms, p90 " << scaled.Latency.GetPercentile(90) << " ms, p99 "
+              << scaled.Latency.GetPercentile(99) << " ms, max " << scaled.Latency.GetMax() << " ms" << std::endl;
+    for (size_t worker = 0; worker < scaled.WorkerLatencies.size(); worker++)
+    {
+        const auto& latency = scaled.WorkerLatencies[worker];
+        std::cout << "  Thread " << worker << " (session " << worker / threadsPerSession << "): average "
+                  << latency.GetAverage() << " ms, stdev " << latency.GetStdev() << " ms, p50 "
+                  << latency.GetPercentile(50) << " ms, p99 " << latency.GetPercentile(99) << " ms" << std::endl;
+    }
+
+    if (args.IsOutputPerf())
+    {
+        auto perfFileMetadata = args.GetPerformanceFileMetadata();
+        perfFileMetadata.emplace_back("throughput sessions", std::to_string(numSessions));
+        perfFileMetadata.emplace_back("throughput threads per session", std::to_string(threadsPerSession));
+        perfFileMetadata.emplace_back("baseline inferences/sec", std::to_string(baseline.InferencesPerSecond()));
+        perfFileMetadata.emplace_back("aggregate inferences/sec", std::to_string(scaled.InferencesPerSecond()));
+        perfFileMetadata.emplace_back("scaling efficiency", std::to_string(scalingEfficiency));
+        perfFileMetadata.emplace_back("throughput average latency (ms)", std::to_string(scaled.Latency.GetAverage()));
+        perfFileMetadata.emplace_back("throughput p50 latency (ms)", std::to_string(scaled.Latency.GetPercentile(50)));
+        perfFileMetadata.emplace_back("throughput p90 latency (ms)", std::to_string(scaled.Latency.GetPercentile(90)));
+        perfFileMetadata.emplace_back("throughput p99 latency (ms)", std::to_string(scaled.Latency.GetPercentile(99)));
+        perfFileMetadata.emplace_back("throughput max latency (ms)", std::to_string(scaled.Latency.GetMax()));
+        output.WritePerformanceDataToCSV(profiler, args.NumIterations(), modelPath,
+                                         TypeHelper::Stringify(device.DeviceType), TypeHelper::Stringify(inputDataType),
+                                         TypeHelper::Stringify(inputBindingType),
+                                         TypeHelper::Stringify(device.DeviceCreationLocation), perfFileMetadata);
+    }
+}
+
+// Measures how loading the models scales with 1 up to -NumThreads threads, then how evaluating each model on each
+// device scales when the threads share one session and when each thread has its own session of one shared model.
+HRESULT RunConcurrencyBenchmark(CommandLineArgs& args, OutputHelper& output, Profiler<WINML_MODEL_TEST_PERF>& profiler,
+                                const std::vector<std::wstring>& modelPaths,
+                                const std::vector<LearningModelDeviceWithMetadata>& deviceList,
+                                const LearningModelSessionOptions& sessionOptions)
+{
+    std::vector<ConcurrencyScalingPoint> points =
+        ConcurrentLoadModel(modelPaths, args.NumThreads(), args.ThreadInterval(), !args.TerseOutput(),
+                            args.WorkerThreadPlacement());
+
+    // The workers time their own evaluations, the shared profiler is not safe to use from several threads.
+    CommandLineArgs workerArgs = args;
+    workerArgs.TogglePerformanceCapture(false);
+    workerArgs.TogglePerIterationPerformanceCapture(false);
+    const InputBindingType inputBindingType = args.FetchInputBindingTypes().front();
+    const InputDataType inputDataType = args.FetchInputDataTypes().front();
+    const std::wstring imagePath = args.IsImageInput() ? args.ImagePaths().front() : L"";
+    HRESULT lastHr = S_OK;
+    for (const auto& path : modelPaths)
+    {
+        LearningModel model = nullptr;
+        LoadModel(model, path, false, output, workerArgs, 0, profiler);
+        for (const auto& device : deviceList)
+        {
+            lastHr = CheckIfModelAndConfigurationsAreSupported(model, path, device.DeviceType, { inputDataType });
+            if (FAILED(lastHr))
+            {
+                continue;
+            }
+            for (unsigned threads : GetScalingThreadCounts(args.NumThreads()))
+            {
+                for (bool isSessionShared : { true, false })
+                {
+                    ThroughputResult result;
+                    lastHr = MeasureThroughput(result, isSessionShared ? 1 : threads, isSessionShared ? threads : 1,
+                                               model, device, workerArgs, output, inputBindingType, inputDataType,
+                                               profiler, imagePath, sessionOptions, nullptr);
+                    if (FAILED(lastHr))
+                    {
+                        break;
+                    }
+                    ConcurrencyScalingPoint point;
+                    point.Phase = isSessionShared ? L"evaluate shared session" : L"evaluate shared model";
+                    point.ModelPath = path;
+                    std::string deviceType = TypeHelper::Stringify(device.DeviceType);
+                    point.Device = std::wstring(deviceType.begin(), deviceType.end());
+                    point.NumThreads = threads;
+                    point.WallTime = result.WallTime;
+                    point.Latency = result.Latency;
+                    point.ThreadLatencies = result.WorkerLatencies;
+                    points.push_back(point);
+                }
+            }
+        }
+    }
+    WriteConcurrencyScaling(points, args.IsOutputPerf() ? GetScalingCsvPath(args.OutputPath()) : L"");
+    return lastHr;
+}
+
+std::wstring GetDeviceTypeArgument(DeviceType deviceType)
+{
+    switch (deviceType)
+    {
+        case DeviceType::CPU:
+            return L"-CPU";
+        case DeviceType::DefaultGPU:
+            return L"-GPU";
+        case DeviceType::MinPowerGPU:
+            return L"-GPUMinPower";
+        case DeviceType::HighPerfGPU:
+            return L"-GPUHighPerformance";
+    }
+    throw hresult_invalid_argument(L"No argument for this DeviceType.");
+}
+
+std::wstring GetInputBindingTypeArgument(InputBindingType inputBindingType)
+{
+    return inputBindingType == InputBindingType::CPU ? L"-CPUBoundInput" : L"-GPUBoundInput";
+}
+
+// Splits the run into one job per model, device and input binding type. Each job runs this executable with the
+// original arguments, minus the ones that select models, devices, bindings and output, plus its own selection.
+int RunSweepConfigurations(CommandLineArgs& args, const std::vector<std::wstring>& modelPaths)
+{
+    // Arguments replaced per job, with the number of values each one takes. -PerfOutput takes an optional value.
+    static const std::vector<std::pair<std::wstring, int>> replacedArguments = {
+        { L"-Model", 1 },        { L"-Folder", 1 },       { L"-PerfOutput", -1 },
+        { L"-SweepWorkers", 1 }, { L"-JobTimeout", 1 },   { L"-CPU", 0 },
+        { L"-GPU", 0 },          { L"-GPUMinPower", 0 },  { L"-GPUHighPerformance", 0 },
+        { L"-CPUBoundInput", 0 }, { L"-GPUBoundInput", 0 }
+    };
+    std::vector<std::wstring> forwardedArguments;
+    const auto& arguments = args.Arguments();
+    for (size_t i = 0; i < arguments.size(); i++)
+    {
+        auto replaced = std::find_if(replacedArguments.begin(), replacedArguments.end(), [&](const auto& argument) {
+            return _wcsicmp(argument.first.c_str(), arguments[i].c_str()) == 0;
+        });
+        if (replaced == replacedArguments.end())
+        {
+            forwardedArguments.push_back(arguments[i]);
+        }
+        else if (replaced->second > 0)
+        {
+            i += replaced->second;
+        }
+        else if (replaced->second < 0 && i + 1 < arguments.size() && arguments[i + 1][0] != L'-')
+        {
+            i++;
+        }
+    }
+    if (!args.IsPerformanceCapture())
+    {
+        // Jobs only write perf results to merge when they capture them
+        forwardedArguments.push_back(L"-Perf");
+    }
+
+    std::vector<std::wstring> deviceArguments;
+    for (DeviceType deviceType : args.FetchDeviceTypes())
+    {
+        deviceArguments.push_back(GetDeviceTypeArgument(deviceType));
+    }
+    std::vector<std::wstring> inputBindingArguments;
+    for (InputBindingType inputBindingType : args.FetchInputBindingTypes())
+    {
+        inputBindingArguments.push_back(GetInputBindingTypeArgument(inputBindingType));
+    }
+
+    std::filesystem::path sweepDirectory(args.OutputPath());
+    sweepDirectory.replace_extension();
+    sweepDirectory += L"_sweep";
+    std::filesystem::create_directories(sweepDirectory);
+
+    std::vector<SweepJob> jobs;
+    for (const auto& modelPath : modelPaths)
+    {
+        for (const auto& deviceArgument : deviceArguments)
+        {
+            for (const auto& inputBindingArgument : inputBindingArguments)
+            {
+                SweepJob job;
+                std::wstring jobNumber = std::to_wstring(jobs.size());
+                job.Name = std::filesystem::path(modelPath).filename().wstring() + L" " + deviceArgument + L" " +
+                           inputBindingArgument;
+                job.CsvPath = (sweepDirectory / (L"job" + jobNumber + L".csv")).wstring();
+                job.LogPath = (sweepDirectory / (L"job" + jobNumber + L".log")).wstring();
+                job.Arguments = forwardedArguments;
+                job.Arguments.insert(job.Arguments.end(), { L"-Model", modelPath, L"-PerfOutput", job.CsvPath,
+                                                            deviceArgument, inputBindingArgument });
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    wchar_t executablePath[MAX_PATH];
+    if (GetModuleFileNameW(nullptr, executablePath, MAX_PATH) == 0)
+    {
+        throw hresult_error(HRESULT_FROM_WIN32(GetLastError()));
+    }
+    return RunSweep(executablePath, jobs, args.SweepWorkers(), args.JobTimeout(), args.OutputPath(),
+                    (sweepDirectory / L"summary.csv").wstring());
+}
+
 int run(CommandLineArgs& args,
         Profiler<WINML_MODEL_TEST_PERF>& profiler,
         const std::vector<LearningModelDeviceWithMetadata>& deviceList,
@@ -540,6 +1734,12 @@ int run(CommandLineArgs& args,
     // Profiler is a wrapper class that captures and stores timing and memory usage data on the
     // CPU and GPU.
     profiler.Enable();
+    if (args.IsPerformanceCapture() || args.IsPerIterationCapture())
+    {
+        // Measures what profiling an empty interval costs before anything else runs, so that it can be subtracted
+        profiler.SetTimingOnly(args.IsPerfTimingOnly());
+        profiler.Calibrate();
+    }
 
     output.SetCSVFileName(args.OutputPath());
     if (args.IsSaveTensor() || args.IsPerIterationCapture())
@@ -548,27 +1748,71 @@ int run(CommandLineArgs& args,
         output.SetDefaultCSVFileNamePerIteration();
     }
 
+    if (args.WorkerThreadPlacement() != ThreadPlacement::None)
+    {
+        const std::vector<LogicalProcessor>& topology = GetProcessorTopology();
+        size_t numCores = 0;
+        size_t numNodes = 0;
+        for (size_t i = 0; i < topology.size(); i++)
+        {
+            numCores += topology[i].Sibling == 0;
+            // The topology is ordered by node
+            numNodes += i == 0 || topology[i].Node != topology[i - 1].Node;
+        }
+        std::cout << "Pinning workers to " << topology.size() << " logical processors on " << numCores
+                  << " cores and " << numNodes << " NUMA nodes" << std::endl;
+    }
+    if (args.IsThreadPoolBenchmark())
+    {
+        // -NumThreads defaults to 1, which has nothing to compare
+        unsigned maxThreads = args.NumThreads() > 1 ? args.NumThreads() : std::thread::hardware_concurrency();
+        RunThreadPoolBenchmark(maxThreads, args.ThreadPoolBenchmarkTasks(),
+                               args.IsBoundedQueue() ? args.MaxQueueDepth() : 1024, args.WorkerThreadPlacement(),
+                               args.IsOutputPerf() ? GetScalingCsvPath(args.OutputPath()) : L"");
+        return 0;
+    }
     if (!args.ModelPath().empty() || !args.FolderPath().empty())
     {
         std::vector<InputBindingType> inputBindingTypes = args.FetchInputBindingTypes();
         std::vector<InputDataType> inputDataTypes = args.FetchInputDataTypes();
+        std::vector<uint32_t> batchSizes = args.IsBatchSizeSweep() ? args.BatchSizes() : std::vector<uint32_t>(1, 1);
         std::vector<std::wstring> modelPaths = args.ModelPath().empty()
                                                    ? GetModelsInDirectory(args, &output)
                                                    : std::vector<std::wstring>(1, args.ModelPath());
         HRESULT lastHr = S_OK;
         if (args.IsConcurrentLoad())
         {
-            ConcurrentLoadModel(modelPaths, args.NumThreads(), args.ThreadInterval(), true);
-            return 0;
+            return RunConcurrencyBenchmark(args, output, profiler, modelPaths, deviceList, sessionOptions);
+        }
+        if (args.IsSweep())
+        {
+            return RunSweepConfigurations(args, modelPaths);
         }
-        for (const auto& path : modelPaths)
+        std::unique_ptr<ModelPrefetcher> modelPrefetcher;
+        if (args.IsPrefetchingModels())
         {
+            modelPrefetcher = std::make_unique<ModelPrefetcher>(modelPaths, args, deviceList, sessionOptions);
+        }
+        for (size_t modelIndex = 0; modelIndex < modelPaths.size(); modelIndex++)
+        {
+            const auto& path = modelPaths[modelIndex];
             LearningModel model = nullptr;
-
-            LoadModel(model, path, args.IsPerformanceCapture() || args.IsPerIterationCapture(), output, args, 0,
-                      profiler);
-            for (auto& learningModelDevice : deviceList)
+            std::shared_ptr<PrefetchedModel> prefetchedModel;
+            if (modelPrefetcher)
             {
+                prefetchedModel = AcquirePrefetchedModel(*modelPrefetcher, modelIndex, path,
+                                                         args.IsPerformanceCapture() || args.IsPerIterationCapture(),
+                                                         output, args, 0, profiler);
+                model = prefetchedModel->Model;
+            }
+            else
+            {
+                LoadModel(model, path, args.IsPerformanceCapture() || args.IsPerIterationCapture(), output, args, 0,
+                          profiler);
+            }
+            for (size_t deviceIndex = 0; deviceIndex < deviceList.size(); deviceIndex++)
+            {
+                const auto& learningModelDevice = deviceList[deviceIndex];
                 lastHr = CheckIfModelAndConfigurationsAreSupported(model, path, learningModelDevice.DeviceType, inputDataTypes);
                 if (FAILED(lastHr))
                 {
@@ -577,46 +1821,98 @@ int run(CommandLineArgs& args,
 #if defined(_AMD64_)
                 StartPIXCapture(output);
 #endif
+                // Generated input features depend on the device they were created for, so they are only shared
+                // between the configurations and iterations of one model/device pair.
+                InputFeatureCache inputFeatureCache;
+                InputFeatureCache* inputFeatureCachePtr = args.IsCachingInputFeatures() ? &inputFeatureCache : nullptr;
                 LearningModelSession session = nullptr;
+                SessionCache sessionCache;
                 for (auto inputDataType : inputDataTypes)
                 {
                     for (auto inputBindingType : inputBindingTypes)
                     {
-                        // Clear up session, bind, eval performance metrics after configuration iteration
-                        if (args.IsPerformanceCapture() || args.IsPerIterationCapture())
-                        {
-                            // Resets all values from profiler for bind and evaluate.
-                            profiler.Reset(WINML_MODEL_TEST_PERF::BIND_VALUE, WINML_MODEL_TEST_PERF::COUNT);
-                        }
-                        for (uint32_t sessionCreationIteration = 0;
-                            sessionCreationIteration < args.NumSessionCreationIterations();
-                            sessionCreationIteration++)
+                        for (uint32_t batchSize : batchSizes)
                         {
-                            lastHr = CreateSession(session, model, learningModelDevice,args, output, profiler, sessionOptions);
-                            if (FAILED(lastHr))
+                            LearningModelSessionOptions batchSessionOptions = sessionOptions;
+                            if (args.IsBatchSizeSweep())
                             {
-                                continue;
+                                lastHr = CheckIfBatchSizeIsSupported(model, batchSize, inputDataType);
+                                if (SUCCEEDED(lastHr))
+                                {
+                                    lastHr = CreateBatchSessionOptions(batchSize, batchSessionOptions);
+                                }
+                                if (FAILED(lastHr))
+                                {
+                                    continue;
+                                }
+                            }
+                            args.SetBatchSize(batchSize);
+
+                            // Clear up session, bind, eval performance metrics after configuration iteration
+                            if (args.IsPerformanceCapture() || args.IsPerIterationCapture())
+                            {
+                                // Resets all values from profiler for bind and evaluate.
+                                profiler.Reset(WINML_MODEL_TEST_PERF::BIND_VALUE, WINML_MODEL_TEST_PERF::COUNT);
                             }
-                            if (args.IsImageInput())
+                            if (args.IsThroughputMode())
                             {
-                                for (const std::wstring& inputImagePath : args.ImagePaths())
+                                std::vector<std::wstring> imagePaths =
+                                    args.IsImageInput() ? args.ImagePaths() : std::vector<std::wstring>(1, L"");
+                                for (const std::wstring& inputImagePath : imagePaths)
                                 {
-                                    RunConfiguration(args, output, session, lastHr, inputBindingType, inputDataType,
-                                                     profiler, path, inputImagePath, sessionCreationIteration,
-                                                     learningModelDevice);
+                                    RunThroughputConfiguration(args, output, model, lastHr, inputBindingType,
+                                                               inputDataType, profiler, path, inputImagePath,
+                                                               learningModelDevice, batchSessionOptions,
+                                                               inputFeatureCachePtr);
                                 }
+                                continue;
                             }
-                            else
+                            for (uint32_t sessionCreationIteration = 0;
+                                sessionCreationIteration < args.NumSessionCreationIterations();
+                                sessionCreationIteration++)
                             {
-                                RunConfiguration(args, output, session, lastHr, inputBindingType, inputDataType,
-                                                 profiler, path, L"", sessionCreationIteration,
-                                                 learningModelDevice);
+                                lastHr = AcquireSession(sessionCache, session, model, prefetchedModel.get(),
+                                                        deviceIndex, learningModelDevice, args, output, profiler,
+                                                        batchSessionOptions);
+                                if (FAILED(lastHr))
+                                {
+                                    continue;
+                                }
+                                if (args.IsImageInput())
+                                {
+                                    for (const std::wstring& inputImagePath : args.ImagePaths())
+                                    {
+                                        RunConfiguration(args, output, session, lastHr, inputBindingType,
+                                                         inputDataType, profiler, path, inputImagePath,
+                                                         sessionCreationIteration, learningModelDevice,
+                                                         inputFeatureCachePtr);
+                                    }
+                                }
+                                else
+                                {
+                                    RunConfiguration(args, output, session, lastHr, inputBindingType, inputDataType,
+                                                     profiler, path, L"", sessionCreationIteration,
+                                                     learningModelDevice, inputFeatureCachePtr);
+                                }
+                                if (args.IsRecreatingSession())
+                                {
+                                    // Close and destroy session
+                                    session.Close();
+                                }
                             }
-                            // Close and destroy session
-                            session.Close();
                         }
                     }
                 }
+                for (auto& cachedSession : sessionCache)
+                {
+                    cachedSession.second.Close();
+                }
+                uint32_t cacheLookups = inputFeatureCache.Hits() + inputFeatureCache.Misses();
+                if (args.IsPerformanceCapture() && cacheLookups > 0)
+                {
+                    printf("\nInput feature cache: %u hits, %u misses (%.1f%% hit rate)\n", inputFeatureCache.Hits(),
+                           inputFeatureCache.Misses(), 100.0 * inputFeatureCache.Hits() / cacheLookups);
+                }
             }
         }
         return lastHr;
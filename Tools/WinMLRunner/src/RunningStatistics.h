@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Count, mean, variance, minimum and maximum of a stream of values in constant memory. The mean and variance are
+// updated with Welford's algorithm, which unlike a sum of squares doesn't lose the variance to cancellation when it is
+// small next to the mean, and merged with the pairwise update of Chan et al.
+class RunningMoments
+{
+public:
+    RunningMoments() { Reset(); }
+
+    void Reset()
+    {
+        m_count = 0;
+        m_mean = 0;
+        m_m2 = 0;
+        m_min = 0;
+        m_max = 0;
+    }
+
+    void Record(double value)
+    {
+        m_count++;
+        double delta = value - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (value - m_mean);
+        m_min = m_count == 1 ? value : (std::min)(m_min, value);
+        m_max = m_count == 1 ? value : (std::max)(m_max, value);
+    }
+
+    void Merge(const RunningMoments& other)
+    {
+        if (other.m_count == 0)
+            return;
+        if (m_count == 0)
+        {
+            *this = other;
+            return;
+        }
+
+        uint64_t count = m_count + other.m_count;
+        double delta = other.m_mean - m_mean;
+        m_mean += delta * other.m_count / count;
+        m_m2 += other.m_m2 + delta * delta * (static_cast<double>(m_count) * other.m_count / count);
+        m_count = count;
+        m_min = (std::min)(m_min, other.m_min);
+        m_max = (std::max)(m_max, other.m_max);
+    }
+
+    uint64_t GetCount() const { return m_count; }
+    double GetTotal() const { return m_mean * m_count; }
+    double GetAverage() const { return m_mean; }
+    // Population variance, like the profiler always reported
+    double GetVariance() const { return m_count > 0 ? m_m2 / m_count : 0; }
+    double GetStdev() const { return sqrt(GetVariance()); }
+    double GetMin() const { return m_min; }
+    double GetMax() const { return m_max; }
+
+private:
+    uint64_t m_count;
+    double m_mean;
+    double m_m2; // sum of squared differences from the mean
+    double m_min;
+    double m_max;
+};
+
+// Estimates one quantile of a stream of values in constant memory with the P-square algorithm of Jain and Chlamtac.
+// Five markers track the minimum, the quantile, the maximum and the points halfway between, and their heights are
+// moved along a piecewise parabola as values arrive. Exact for up to five values. Unlike Histogram it accepts
+// negative values, but merging two estimates of more than five values each is only approximate.
+class P2Quantile
+{
+public:
+    // quantile is in [0, 1]
+    explicit P2Quantile(double quantile = 0.5) : m_quantile(quantile) { Reset(); }
+
+    void Reset()
+    {
+        m_count = 0;
+        for (int i = 0; i < MarkerCount; ++i)
+        {
+            m_heights[i] = 0;
+            m_positions[i] = i + 1;
+        }
+        double increments[MarkerCount] = { 0, m_quantile / 2, m_quantile, (1 + m_quantile) / 2, 1 };
+        for (int i = 0; i < MarkerCount; ++i)
+        {
+            m_increments[i] = increments[i];
+            m_desiredPositions[i] = 1 + 4 * increments[i];
+        }
+    }
+
+    void Record(double value)
+    {
+        if (m_count < MarkerCount)
+        {
+            m_heights[m_count++] = value;
+            if (m_count == MarkerCount)
+            {
+                std::sort(m_heights, m_heights + MarkerCount);
+            }
+            return;
+        }
+
+        // Find the cell the value falls in, extending the extreme markers if it is outside of them
+        int cell;
+        if (value < m_heights[0])
+        {
+            m_heights[0] = value;
+            cell = 0;
+        }
+        else if (value >= m_heights[MarkerCount - 1])
+        {
+            m_heights[MarkerCount - 1] = value;
+            cell = MarkerCount - 2;
+        }
+        else
+        {
+            cell = 0;
+            while (value >= m_heights[cell + 1])
+            {
+                cell++;
+            }
+        }
+        m_count++;
+        for (int i = cell + 1; i < MarkerCount; ++i)
+        {
+            m_positions[i]++;
+        }
+        for (int i = 0; i < MarkerCount; ++i)
+        {
+            m_desiredPositions[i] += m_increments[i];
+        }
+        AdjustMarkers();
+    }
+
+    void Merge(const P2Quantile& other)
+    {
+        if (other.m_count <= MarkerCount)
+        {
+            for (uint64_t i = 0; i < other.m_count; ++i)
+            {
+                Record(other.m_heights[i]);
+            }
+            return;
+        }
+        if (m_count <= MarkerCount)
+        {
+            P2Quantile merged = other;
+            for (uint64_t i = 0; i < m_count; ++i)
+            {
+                merged.Record(m_heights[i]);
+            }
+            *this = merged;
+            return;
+        }
+
+        // Interpolates the markers by count and places them where a single stream of all values would want them
+        uint64_t count = m_count + other.m_count;
+        for (int i = 0; i < MarkerCount; ++i)
+        {
+            m_heights[i] = (m_heights[i] * m_count + other.m_heights[i] * other.m_count) / count;
+            m_desiredPositions[i] = 1 + (count - 1) * m_increments[i];
+        }
+        m_heights[0] = (std::min)(m_heights[0], other.m_heights[0]);
+        m_heights[MarkerCount - 1] = (std::max)(m_heights[MarkerCount - 1], other.m_heights[MarkerCount - 1]);
+        m_count = count;
+        m_positions[0] = 1;
+        m_positions[MarkerCount - 1] = static_cast<double>(count);
+        for (int i = 1; i < MarkerCount - 1; ++i)
+        {
+            m_positions[i] = (std::max)(round(m_desiredPositions[i]), m_positions[i - 1] + 1);
+        }
+    }
+
+    uint64_t GetCount() const { return m_count; }
+
+    double Get() const
+    {
+        if (m_count == 0)
+            return 0;
+        if (m_count > MarkerCount)
+            return m_heights[2];
+
+        // Nearest rank among the values seen so far
+        double sorted[MarkerCount];
+        std::copy(m_heights, m_heights + m_count, sorted);
+        std::sort(sorted, sorted + m_count);
+        uint64_t rank = static_cast<uint64_t>(ceil(m_quantile * m_count));
+        return sorted[rank == 0 ? 0 : rank - 1];
+    }
+
+private:
+    static constexpr int MarkerCount = 5;
+
+    void AdjustMarkers()
+    {
+        for (int i = 1; i < MarkerCount - 1; ++i)
+        {
+            double offset = m_desiredPositions[i] - m_positions[i];
+            if ((offset >= 1 && m_positions[i + 1] - m_positions[i] > 1) ||
+                (offset <= -1 && m_positions[i - 1] - m_positions[i] < -1))
+            {
+                int step = offset > 0 ? 1 : -1;
+                double height = GetParabolicHeight(i, step);
+                if (m_heights[i - 1] < height && height < m_heights[i + 1])
+                {
+                    m_heights[i] = height;
+                }
+                else
+                {
+                    // The parabola overshot a neighbour, fall back to linear interpolation
+                    m_heights[i] += step * (m_heights[i + step] - m_heights[i]) /
+                                    (m_positions[i + step] - m_positions[i]);
+                }
+                m_positions[i] += step;
+            }
+        }
+    }
+
+    double GetParabolicHeight(int i, int step) const
+    {
+        double left = m_positions[i] - m_positions[i - 1];
+        double right = m_positions[i + 1] - m_positions[i];
+        return m_heights[i] + step / (m_positions[i + 1] - m_positions[i - 1]) *
+                                  ((left + step) * (m_heights[i + 1] - m_heights[i]) / right +
+                                   (right - step) * (m_heights[i] - m_heights[i - 1]) / left);
+    }
+
+    double m_quantile;
+    uint64_t m_count;
+    // Hold the values themselves until there are MarkerCount of them
+    double m_heights[MarkerCount];
+    double m_positions[MarkerCount];
+    double m_desiredPositions[MarkerCount];
+    double m_increments[MarkerCount];
+};
@@ -1,9 +1,64 @@
 #pragma once
 
 #include "common.h"
+#include "TimerHelper.h"
+#include "ThreadPlacement.h"
 
-// load a model in a multi-threaded environment with num_threads number of
-// threads Each thread will load a model once, with interval in milliseconds for
-// each thread tasks
-void ConcurrentLoadModel(const std::vector<std::wstring>& paths, unsigned num_threads, unsigned interval_milliseconds,
-                         bool print_info);
+// One point of a concurrency scaling curve: num_threads threads sharing the operations of one phase
+struct ConcurrencyScalingPoint
+{
+    std::wstring Phase;
+    std::wstring ModelPath;
+    std::wstring Device;
+    unsigned NumThreads = 0;
+    double WallTime = 0; // in ms
+    // Latencies of all operations and of the operations of each thread
+    LatencySummary Latency;
+    std::vector<LatencySummary> ThreadLatencies;
+
+    double OperationsPerSecond() const { return WallTime > 0 ? Latency.GetCount() * 1000.0 / WallTime : 0; }
+};
+
+// Thread counts of a scaling curve up to max_threads: the powers of two below it and max_threads itself
+std::vector<unsigned> GetScalingThreadCounts(unsigned max_threads);
+
+// Loads the models with 1 up to num_threads threads and returns one point per thread count. Every thread count loads
+// the same max(paths.size(), num_threads) models so that wall times are comparable. Threads start
+// interval_milliseconds apart and then keep taking the next model to load until there are none left.
+std::vector<ConcurrencyScalingPoint> ConcurrentLoadModel(const std::vector<std::wstring>& paths, unsigned num_threads,
+                                                         unsigned interval_milliseconds, bool print_info,
+                                                         ThreadPlacement placement = ThreadPlacement::None);
+
+// Compares ThreadPool against WorkStealingThreadPool with 1 up to max_threads workers, submitting tasks with SubmitWork
+// and with Post, and ThreadPool with its queue bounded to max_queue_depth tasks. As many threads as the pool has
+// workers submit num_tasks small tasks between them and wait for them to complete. Latency is the time a task waited
+// between being submitted and starting. Workers are pinned according to placement and process every task in their own
+// scratch memory.
+void RunThreadPoolBenchmark(unsigned max_threads, unsigned num_tasks, size_t max_queue_depth,
+                            ThreadPlacement placement, const std::wstring& csv_path);
+
+// The file next to a -PerfOutput CSV that scaling curves are written to, <perf>_scaling.csv, since their columns differ
+// from the perf results. Empty if perf_csv_path is.
+std::wstring GetScalingCsvPath(const std::wstring& perf_csv_path);
+
+// Prints the scaling curve and appends it to csv_path unless it is empty. Scaling efficiency and contention ratio are
+// relative to the single thread point of the same phase, model and device.
+void WriteConcurrencyScaling(const std::vector<ConcurrencyScalingPoint>& points, const std::wstring& csv_path);
+
+// One invocation of a worker process in a sweep
+struct SweepJob
+{
+    std::wstring Name;
+    std::vector<std::wstring> Arguments;
+    // Performance CSV the job writes, merged into the sweep output once all jobs are done
+    std::wstring CsvPath;
+    // Console output of the job
+    std::wstring LogPath;
+};
+
+// Runs each job as a child process of executablePath with at most num_workers jobs at a time. Every worker slot is
+// pinned to a disjoint set of the CPUs this process may run on. A job running longer than timeout_seconds (0: no
+// limit) is terminated. The jobs' CSVs are merged into merged_csv_path and a per-job summary is written next to it.
+// Returns 0 if every job succeeded, otherwise the exit code of the first job that did not.
+int RunSweep(const std::wstring& executablePath, const std::vector<SweepJob>& jobs, unsigned num_workers,
+             unsigned timeout_seconds, const std::wstring& merged_csv_path, const std::wstring& summary_csv_path);
@@ -0,0 +1,320 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <iomanip>
+
+#include "Windows.h"
+#include "common.h"
+#include "Scenarios.h"
+
+enum class SweepJobStatus
+{
+    NotStarted,
+    Succeeded,
+    Failed,
+    TimedOut,
+    LaunchFailed
+};
+
+struct SweepJobResult
+{
+    SweepJobStatus status = SweepJobStatus::NotStarted;
+    DWORD exit_code = 0;
+    double seconds = 0;
+};
+
+struct RunningSweepJob
+{
+    size_t job_index;
+    unsigned worker;
+    PROCESS_INFORMATION process_info;
+    std::chrono::steady_clock::time_point start;
+};
+
+static const char* StatusToString(SweepJobStatus status)
+{
+    switch (status)
+    {
+        case SweepJobStatus::Succeeded:
+            return "Succeeded";
+        case SweepJobStatus::Failed:
+            return "Failed";
+        case SweepJobStatus::TimedOut:
+            return "TimedOut";
+        case SweepJobStatus::LaunchFailed:
+            return "LaunchFailed";
+        default:
+            return "NotStarted";
+    }
+}
+
+// Quotes an argument so that CommandLineToArgvW in the child gives it back unchanged.
+static std::wstring QuoteArgument(const std::wstring& argument)
+{
+    if (!argument.empty() && argument.find_first_of(L" \t\"") == std::wstring::npos)
+    {
+        return argument;
+    }
+    std::wstring quoted = L"\"";
+    size_t backslashes = 0;
+    for (wchar_t c : argument)
+    {
+        if (c == L'\\')
+        {
+            backslashes++;
+            continue;
+        }
+        // Backslashes are only special in front of a quote
+        quoted.append(c == L'"' ? backslashes * 2 + 1 : backslashes, L'\\');
+        backslashes = 0;
+        quoted.push_back(c);
+    }
+    quoted.append(backslashes * 2, L'\\');
+    quoted.push_back(L'"');
+    return quoted;
+}
+
+// Splits the CPUs of this process into num_workers disjoint masks. Only the processor group of the calling process is
+// used. Returns no masks if there are fewer CPUs than workers, in which case workers are not pinned.
+static std::vector<DWORD_PTR> PartitionAffinity(unsigned num_workers)
+{
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+    {
+        return {};
+    }
+    std::vector<DWORD_PTR> cpus;
+    for (unsigned bit = 0; bit < sizeof(DWORD_PTR) * 8; bit++)
+    {
+        if (process_mask & (static_cast<DWORD_PTR>(1) << bit))
+        {
+            cpus.push_back(static_cast<DWORD_PTR>(1) << bit);
+        }
+    }
+    if (cpus.size() < num_workers)
+    {
+        return {};
+    }
+    std::vector<DWORD_PTR> masks(num_workers, 0);
+    size_t cpus_per_worker = cpus.size() / num_workers;
+    for (unsigned worker = 0; worker < num_workers; worker++)
+    {
+        for (size_t cpu = worker * cpus_per_worker; cpu < (worker + 1) * cpus_per_worker; cpu++)
+        {
+            masks[worker] |= cpus[cpu];
+        }
+    }
+    return masks;
+}
+
+// Returns ERROR_SUCCESS, or the error that kept the job from starting
+static DWORD LaunchSweepJob(const std::wstring& executable_path, const SweepJob& job, DWORD_PTR affinity_mask,
+                            PROCESS_INFORMATION& process_info)
+{
+    std::wstring command_line = QuoteArgument(executable_path);
+    for (const auto& argument : job.Arguments)
+    {
+        command_line += L" " + QuoteArgument(argument);
+    }
+
+    // The log handle is the only inheritable handle open while the child is created, so jobs don't hold on to each
+    // other's logs.
+    SECURITY_ATTRIBUTES security_attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE log = CreateFileW(job.LogPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security_attributes, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (log == INVALID_HANDLE_VALUE)
+    {
+        return GetLastError();
+    }
+    STARTUPINFOW startup_info = {};
+    startup_info.cb = sizeof(startup_info);
+    startup_info.dwFlags = STARTF_USESTDHANDLES;
+    startup_info.hStdOutput = log;
+    startup_info.hStdError = log;
+    process_info = {};
+    // Started suspended so that the affinity is in place before the job does any work
+    BOOL created = CreateProcessW(nullptr, &command_line[0], nullptr, nullptr, TRUE, CREATE_SUSPENDED, nullptr,
+                                  nullptr, &startup_info, &process_info);
+    // Read before CloseHandle, which would overwrite it
+    DWORD error = created ? ERROR_SUCCESS : GetLastError();
+    CloseHandle(log);
+    if (!created)
+    {
+        return error;
+    }
+    if (affinity_mask != 0 && !SetProcessAffinityMask(process_info.hProcess, affinity_mask))
+    {
+        std::wcout << L"Could not pin sweep job " << job.Name << L" to its CPUs" << std::endl;
+    }
+    ResumeThread(process_info.hThread);
+    return ERROR_SUCCESS;
+}
+
+// Appends the rows of every job that succeeded to the merged CSV. The header is written once, when the merged CSV is
+// new. Jobs that failed or timed out may have written only some of their rows, so they are left out.
+static void MergeSweepCsvs(const std::vector<SweepJob>& jobs, const std::vector<SweepJobResult>& results,
+                           const std::wstring& merged_csv_path)
+{
+    std::ifstream existing(merged_csv_path);
+    bool write_header = !existing.good() || existing.peek() == std::ifstream::traits_type::eof();
+    existing.close();
+
+    std::ofstream merged(merged_csv_path, std::ios::app);
+    std::string merged_header;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const SweepJob& job = jobs[i];
+        if (results[i].status != SweepJobStatus::Succeeded)
+        {
+            continue;
+        }
+        std::ifstream job_csv(job.CsvPath);
+        std::string header;
+        if (!job_csv.is_open() || !std::getline(job_csv, header))
+        {
+            continue;
+        }
+        if (merged_header.empty())
+        {
+            merged_header = header;
+            if (write_header)
+            {
+                merged << header << std::endl;
+            }
+        }
+        else if (header != merged_header)
+        {
+            std::wcout << L"Columns of sweep job " << job.Name << L" differ from the other jobs" << std::endl;
+        }
+        std::string row;
+        while (std::getline(job_csv, row))
+        {
+            if (!row.empty())
+            {
+                merged << row << std::endl;
+            }
+        }
+    }
+}
+
+static void WriteSweepSummary(const std::vector<SweepJob>& jobs, const std::vector<SweepJobResult>& results,
+                              const std::wstring& summary_csv_path)
+{
+    std::wofstream summary(summary_csv_path);
+    summary << L"job,status,exit code,seconds,log" << std::endl;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        summary << jobs[i].Name << L"," << StatusToString(results[i].status) << L"," << results[i].exit_code << L","
+                << results[i].seconds << L"," << jobs[i].LogPath << std::endl;
+    }
+}
+
+int RunSweep(const std::wstring& executablePath, const std::vector<SweepJob>& jobs, unsigned num_workers,
+             unsigned timeout_seconds, const std::wstring& merged_csv_path, const std::wstring& summary_csv_path)
+{
+    num_workers = (std::max)(1u, (std::min)({ num_workers, static_cast<unsigned>(jobs.size()),
+                                              static_cast<unsigned>(MAXIMUM_WAIT_OBJECTS) }));
+    std::vector<DWORD_PTR> affinity_masks = PartitionAffinity(num_workers);
+    if (affinity_masks.empty())
+    {
+        std::cout << "Fewer CPUs than sweep workers, workers will not be pinned." << std::endl;
+    }
+    std::cout << "Sweeping " << jobs.size() << " jobs on " << num_workers << " workers" << std::endl;
+
+    std::vector<SweepJobResult> results(jobs.size());
+    std::vector<RunningSweepJob> running;
+    std::vector<unsigned> free_workers;
+    for (unsigned worker = num_workers; worker > 0; worker--)
+    {
+        free_workers.push_back(worker - 1);
+    }
+    const auto timeout = std::chrono::seconds(timeout_seconds);
+    size_t next_job = 0;
+    while (next_job < jobs.size() || !running.empty())
+    {
+        while (next_job < jobs.size() && !free_workers.empty())
+        {
+            RunningSweepJob job = { next_job, free_workers.back(), {}, std::chrono::steady_clock::now() };
+            // Jobs append to their CSV, so the rows of a previous sweep with the same -PerfOutput are removed first
+            DeleteFileW(jobs[next_job].CsvPath.c_str());
+            DWORD error = LaunchSweepJob(executablePath, jobs[next_job],
+                                         affinity_masks.empty() ? 0 : affinity_masks[job.worker], job.process_info);
+            if (error != ERROR_SUCCESS)
+            {
+                results[next_job].status = SweepJobStatus::LaunchFailed;
+                results[next_job].exit_code = error;
+                std::wcout << L"[LAUNCH FAILED] " << jobs[next_job].Name << std::endl;
+            }
+            else
+            {
+                free_workers.pop_back();
+                running.push_back(job);
+            }
+            next_job++;
+        }
+        if (running.empty())
+        {
+            continue;
+        }
+
+        // Wake up when a job finishes or when the job closest to its deadline runs out of time
+        DWORD wait_milliseconds = INFINITE;
+        auto now = std::chrono::steady_clock::now();
+        std::vector<HANDLE> processes;
+        for (const auto& job : running)
+        {
+            processes.push_back(job.process_info.hProcess);
+            if (timeout_seconds > 0)
+            {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(job.start + timeout - now);
+                wait_milliseconds =
+                    (std::min)(wait_milliseconds, static_cast<DWORD>((std::max)(remaining.count(), 0ll)));
+            }
+        }
+        WaitForMultipleObjects(static_cast<DWORD>(processes.size()), processes.data(), FALSE, wait_milliseconds);
+
+        now = std::chrono::steady_clock::now();
+        for (auto job = running.begin(); job != running.end();)
+        {
+            SweepJobResult& result = results[job->job_index];
+            bool finished = WaitForSingleObject(job->process_info.hProcess, 0) == WAIT_OBJECT_0;
+            if (!finished && timeout_seconds > 0 && now - job->start >= timeout)
+            {
+                TerminateProcess(job->process_info.hProcess, static_cast<UINT>(HRESULT_FROM_WIN32(WAIT_TIMEOUT)));
+                WaitForSingleObject(job->process_info.hProcess, INFINITE);
+                result.status = SweepJobStatus::TimedOut;
+                finished = true;
+            }
+            if (!finished)
+            {
+                ++job;
+                continue;
+            }
+            GetExitCodeProcess(job->process_info.hProcess, &result.exit_code);
+            if (result.status != SweepJobStatus::TimedOut)
+            {
+                result.status = result.exit_code == 0 ? SweepJobStatus::Succeeded : SweepJobStatus::Failed;
+            }
+            result.seconds = std::chrono::duration<double>(now - job->start).count();
+            std::wcout << L"[" << StatusToString(result.status) << L"] " << jobs[job->job_index].Name << L" ("
+                       << std::fixed << std::setprecision(1) << result.seconds << L" s)" << std::endl;
+            CloseHandle(job->process_info.hThread);
+            CloseHandle(job->process_info.hProcess);
+            free_workers.push_back(job->worker);
+            job = running.erase(job);
+        }
+    }
+
+    MergeSweepCsvs(jobs, results, merged_csv_path);
+    WriteSweepSummary(jobs, results, summary_csv_path);
+    std::wcout << L"Sweep summary written to " << summary_csv_path << std::endl;
+    for (const auto& result : results)
+    {
+        if (result.status != SweepJobStatus::Succeeded)
+        {
+            return result.exit_code != 0 ? static_cast<int>(result.exit_code) : E_FAIL;
+        }
+    }
+    return 0;
+}
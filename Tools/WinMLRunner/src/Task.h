@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// The error of tasks that didn't run or stopped early because the work they belonged to was cancelled
+class TaskCancelled : public std::runtime_error
+{
+public:
+    TaskCancelled() : std::runtime_error("The task was cancelled") {}
+};
+
+// The error of tasks that didn't run because the queue of the pool they were submitted to was full
+class TaskRejected : public std::runtime_error
+{
+public:
+    TaskRejected() : std::runtime_error("The task was rejected by a full queue") {}
+};
+
+// A move-only void() callable for thread pool queues. Closures of up to InlineSize bytes are stored in place, so
+// submitting them doesn't allocate. Larger closures fall back to the heap.
+class Task
+{
+public:
+    static constexpr size_t InlineSize = 64;
+
+    Task() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>>
+    Task(F&& f)
+    {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= InlineSize && alignof(Fn) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible<Fn>::value)
+        {
+            new (&m_storage) Fn(std::forward<F>(f));
+            m_operations = &InlineStorage<Fn>::Table;
+        }
+        else
+        {
+            *reinterpret_cast<Fn**>(&m_storage) = new Fn(std::forward<F>(f));
+            m_operations = &HeapStorage<Fn>::Table;
+            s_heapAllocations++;
+        }
+    }
+
+    Task(Task&& other) noexcept { MoveFrom(other); }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    explicit operator bool() const { return m_operations != nullptr; }
+
+    void operator()() { m_operations->Invoke(&m_storage); }
+
+    void Reset()
+    {
+        if (m_operations)
+        {
+            m_operations->Destroy(&m_storage);
+            m_operations = nullptr;
+        }
+    }
+
+    // Number of tasks whose closure didn't fit in place, since the start of the process
+    static size_t HeapAllocations() { return s_heapAllocations; }
+
+private:
+    struct Operations
+    {
+        void (*Invoke)(void* storage);
+        // Move constructs the closure into the destination storage and destroys the source
+        void (*Move)(void* source, void* destination);
+        void (*Destroy)(void* storage);
+    };
+
+    template <typename Fn>
+    struct InlineStorage
+    {
+        static void Invoke(void* storage) { (*static_cast<Fn*>(storage))(); }
+        static void Move(void* source, void* destination)
+        {
+            new (destination) Fn(std::move(*static_cast<Fn*>(source)));
+            static_cast<Fn*>(source)->~Fn();
+        }
+        static void Destroy(void* storage) { static_cast<Fn*>(storage)->~Fn(); }
+        static const Operations Table;
+    };
+
+    template <typename Fn>
+    struct HeapStorage
+    {
+        static void Invoke(void* storage) { (**static_cast<Fn**>(storage))(); }
+        static void Move(void* source, void* destination)
+        {
+            *static_cast<Fn**>(destination) = *static_cast<Fn**>(source);
+        }
+        static void Destroy(void* storage) { delete *static_cast<Fn**>(storage); }
+        static const Operations Table;
+    };
+
+    void MoveFrom(Task& other)
+    {
+        m_operations = other.m_operations;
+        if (m_operations)
+        {
+            m_operations->Move(&other.m_storage, &m_storage);
+            other.m_operations = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[InlineSize];
+    const Operations* m_operations = nullptr;
+
+    static inline std::atomic<size_t> s_heapAllocations{ 0 };
+};
+
+template <typename Fn>
+const Task::Operations Task::InlineStorage<Fn>::Table = { &Invoke, &Move, &Destroy };
+
+template <typename Fn>
+const Task::Operations Task::HeapStorage<Fn>::Table = { &Invoke, &Move, &Destroy };
+
+// A double ended queue of tasks in a ring buffer. It only allocates when it grows past the most tasks it has held, so
+// a pool that has warmed up queues and dequeues tasks without allocating.
+class TaskQueue
+{
+public:
+    bool empty() const { return m_count == 0; }
+    size_t size() const { return m_count; }
+
+    void push_back(Task&& task)
+    {
+        if (m_count == m_tasks.size())
+        {
+            Grow();
+        }
+        m_tasks[(m_head + m_count) % m_tasks.size()] = std::move(task);
+        m_count++;
+    }
+
+    Task pop_front()
+    {
+        Task task = std::move(m_tasks[m_head]);
+        m_head = (m_head + 1) % m_tasks.size();
+        m_count--;
+        return task;
+    }
+
+    Task pop_back()
+    {
+        m_count--;
+        return std::move(m_tasks[(m_head + m_count) % m_tasks.size()]);
+    }
+
+    // Number of times any queue had to grow, since the start of the process
+    static size_t Reallocations() { return s_reallocations; }
+
+private:
+    void Grow()
+    {
+        std::vector<Task> tasks(m_tasks.empty() ? 16 : m_tasks.size() * 2);
+        for (size_t i = 0; i < m_count; i++)
+        {
+            tasks[i] = std::move(m_tasks[(m_head + i) % m_tasks.size()]);
+        }
+        m_tasks.swap(tasks);
+        m_head = 0;
+        s_reallocations++;
+    }
+
+    std::vector<Task> m_tasks;
+    size_t m_head = 0;
+    size_t m_count = 0;
+
+    static inline std::atomic<size_t> s_reallocations{ 0 };
+};
@@ -0,0 +1,183 @@
+#include "TaskGraph.h"
+
+TaskGraph::TaskGraph(ThreadPool& pool) : m_pool(pool) {}
+
+TaskGraph::~TaskGraph()
+{
+    Cancel();
+    // Queued nodes refer to the graph until they have completed
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_completed.wait(lock, [this] { return m_queuedNodes == 0; });
+}
+
+TaskGraph::NodeId TaskGraph::AddNode(Task work, const std::vector<NodeId>& dependencies)
+{
+    NodeId id;
+    std::vector<NodeId> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = m_nodes.size();
+        m_nodes.emplace_back();
+        Node& node = m_nodes.back();
+        node.Work = std::move(work);
+        if (m_isCancelled)
+        {
+            Complete(id, std::make_exception_ptr(TaskCancelled()), ready);
+            return id;
+        }
+
+        for (NodeId dependency : dependencies)
+        {
+            Node& dependencyNode = m_nodes[dependency];
+            if (dependencyNode.State == NodeState::Failed)
+            {
+                Complete(id, dependencyNode.Error, ready);
+                return id;
+            }
+            if (dependencyNode.State != NodeState::Succeeded)
+            {
+                dependencyNode.Dependents.push_back(id);
+                node.RemainingDependencies++;
+            }
+        }
+        if (node.RemainingDependencies == 0)
+        {
+            Submit(id, ready);
+        }
+    }
+    Post(ready);
+    return id;
+}
+
+void TaskGraph::Wait(NodeId id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Node& node = m_nodes[id];
+    m_completed.wait(lock,
+                     [&node] { return node.State == NodeState::Succeeded || node.State == NodeState::Failed; });
+    if (node.Error)
+    {
+        std::rethrow_exception(node.Error);
+    }
+}
+
+void TaskGraph::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isCancelled = true;
+    std::exception_ptr cancelled = std::make_exception_ptr(TaskCancelled());
+    // Failed nodes don't make other nodes ready
+    std::vector<NodeId> ready;
+    for (NodeId id = 0; id < m_nodes.size(); id++)
+    {
+        if (m_nodes[id].State == NodeState::Waiting)
+        {
+            Complete(id, cancelled, ready);
+        }
+    }
+    m_completed.notify_all();
+}
+
+void TaskGraph::Submit(NodeId id, std::vector<NodeId>& ready)
+{
+    // Counted as queued right away, so that the graph outlives the nodes that are about to be posted
+    m_nodes[id].State = NodeState::Queued;
+    m_queuedNodes++;
+    ready.push_back(id);
+}
+
+void TaskGraph::Post(const std::vector<NodeId>& ready)
+{
+    for (NodeId id : ready)
+    {
+        if (!m_pool.Post([this, id]() { Run(id); }))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::vector<NodeId> unused;
+            Complete(id, std::make_exception_ptr(TaskRejected()), unused);
+            m_queuedNodes--;
+            m_completed.notify_all();
+        }
+    }
+}
+
+void TaskGraph::Complete(NodeId id, std::exception_ptr error, std::vector<NodeId>& ready)
+{
+    // Failures propagate to every node that depends on the failed one, directly or not
+    std::vector<NodeId> failed;
+    Node& node = m_nodes[id];
+    node.Work.Reset();
+    node.State = error ? NodeState::Failed : NodeState::Succeeded;
+    node.Error = error;
+    if (error)
+    {
+        failed.push_back(id);
+    }
+    else
+    {
+        for (NodeId dependent : node.Dependents)
+        {
+            if (--m_nodes[dependent].RemainingDependencies == 0 && m_nodes[dependent].State == NodeState::Waiting)
+            {
+                Submit(dependent, ready);
+            }
+        }
+    }
+
+    while (!failed.empty())
+    {
+        Node& failedNode = m_nodes[failed.back()];
+        failed.pop_back();
+        for (NodeId dependent : failedNode.Dependents)
+        {
+            Node& dependentNode = m_nodes[dependent];
+            if (dependentNode.State == NodeState::Waiting)
+            {
+                dependentNode.Work.Reset();
+                dependentNode.State = NodeState::Failed;
+                dependentNode.Error = error;
+                failed.push_back(dependent);
+            }
+        }
+    }
+}
+
+void TaskGraph::Run(NodeId id)
+{
+    Task work;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isCancelled)
+        {
+            error = std::make_exception_ptr(TaskCancelled());
+        }
+        else
+        {
+            work = std::move(m_nodes[id].Work);
+        }
+    }
+    if (work)
+    {
+        try
+        {
+            work();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        work.Reset();
+    }
+
+    std::vector<NodeId> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Complete(id, error, ready);
+        m_queuedNodes--;
+        // Notified with the lock held because the destructor may be waiting for the last queued node
+        m_completed.notify_all();
+    }
+    // The nodes in ready are still counted as queued, so the graph can't be destroyed until they are posted
+    Post(ready);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <vector>
+#include "ThreadPool.h"
+
+// Runs tasks on a ThreadPool as soon as the tasks they depend on have succeeded, so that independent tasks overlap
+// without the caller ordering them. Nodes can be added while the graph is running. A node whose dependency failed
+// doesn't run and fails with the same error, and so do the nodes that depend on it. Destroying the graph cancels the
+// nodes that haven't started and waits for the running ones. A node that the pool rejects fails with TaskRejected.
+class TaskGraph
+{
+public:
+    using NodeId = size_t;
+
+    explicit TaskGraph(ThreadPool& pool);
+    ~TaskGraph();
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // Dependencies must be nodes that were already added. The work is destroyed as soon as it has run, so the state
+    // it captures isn't kept alive by the graph.
+    NodeId AddNode(Task work, const std::vector<NodeId>& dependencies = {});
+
+    // Waits for the node to complete and rethrows its error if it failed
+    void Wait(NodeId node);
+
+    // Nodes that haven't started won't run and fail with TaskCancelled, running nodes complete
+    void Cancel();
+
+private:
+    enum class NodeState
+    {
+        Waiting,
+        Queued,
+        Succeeded,
+        Failed
+    };
+
+    struct Node
+    {
+        Task Work;
+        NodeState State = NodeState::Waiting;
+        size_t RemainingDependencies = 0;
+        std::vector<NodeId> Dependents;
+        std::exception_ptr Error;
+    };
+
+    // These are called with m_mutex held. Nodes that become ready are queued and added to ready, to be posted with
+    // Post once the lock is released.
+    void Submit(NodeId node, std::vector<NodeId>& ready);
+    void Complete(NodeId node, std::exception_ptr error, std::vector<NodeId>& ready);
+
+    // Called without m_mutex held, as posting to a full pool can block
+    void Post(const std::vector<NodeId>& ready);
+
+    void Run(NodeId node);
+
+    ThreadPool& m_pool;
+    std::mutex m_mutex;
+    std::condition_variable m_completed;
+    // A deque so that nodes don't move as more are added
+    std::deque<Node> m_nodes;
+    size_t m_queuedNodes = 0;
+    bool m_isCancelled = false;
+};
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <map>
+#include <new>
+#include <tuple>
+
+#include "Windows.h"
+#include "ThreadPlacement.h"
+
+static std::vector<LogicalProcessor> QueryProcessorTopology()
+{
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+    std::vector<uint8_t> buffer(length);
+    if (length == 0 ||
+        !GetLogicalProcessorInformationEx(
+            RelationAll, reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &length))
+    {
+        return {};
+    }
+
+    std::vector<LogicalProcessor> processors;
+    std::vector<std::pair<DWORD, GROUP_AFFINITY>> nodes;
+    unsigned core = 0;
+    for (DWORD offset = 0; offset < length;)
+    {
+        auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+        if (info->Relationship == RelationProcessorCore)
+        {
+            unsigned sibling = 0;
+            for (WORD group = 0; group < info->Processor.GroupCount; group++)
+            {
+                const GROUP_AFFINITY& mask = info->Processor.GroupMask[group];
+                for (uint8_t number = 0; number < sizeof(KAFFINITY) * 8; number++)
+                {
+                    if (mask.Mask & (static_cast<KAFFINITY>(1) << number))
+                    {
+                        LogicalProcessor processor;
+                        processor.Group = mask.Group;
+                        processor.Number = number;
+                        processor.Core = core;
+                        processor.Sibling = sibling++;
+                        processors.push_back(processor);
+                    }
+                }
+            }
+            core++;
+        }
+        else if (info->Relationship == RelationNumaNode)
+        {
+            nodes.emplace_back(info->NumaNode.NodeNumber, info->NumaNode.GroupMask);
+        }
+        offset += info->Size;
+    }
+
+    for (auto& processor : processors)
+    {
+        for (auto& node : nodes)
+        {
+            if (node.second.Group == processor.Group &&
+                (node.second.Mask & (static_cast<KAFFINITY>(1) << processor.Number)))
+            {
+                processor.Node = node.first;
+            }
+        }
+    }
+    std::sort(processors.begin(), processors.end(), [](const LogicalProcessor& a, const LogicalProcessor& b) {
+        return std::tie(a.Node, a.Core, a.Sibling) < std::tie(b.Node, b.Core, b.Sibling);
+    });
+    return processors;
+}
+
+const std::vector<LogicalProcessor>& GetProcessorTopology()
+{
+    static const std::vector<LogicalProcessor> topology = QueryProcessorTopology();
+    return topology;
+}
+
+std::vector<LogicalProcessor> PlaceThreads(size_t num_threads, ThreadPlacement placement)
+{
+    const std::vector<LogicalProcessor>& topology = GetProcessorTopology();
+    if (placement == ThreadPlacement::None || topology.empty())
+    {
+        return {};
+    }
+
+    // The topology is already packed
+    std::vector<LogicalProcessor> order = topology;
+    if (placement == ThreadPlacement::Spread)
+    {
+        // Rank of every core within its node, so that the n-th core of each node comes before the n+1-th
+        std::map<unsigned, unsigned> core_ranks;
+        std::map<unsigned, unsigned> node_cores;
+        for (const auto& processor : topology)
+        {
+            if (processor.Sibling == 0)
+            {
+                core_ranks[processor.Core] = node_cores[processor.Node]++;
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](const LogicalProcessor& a, const LogicalProcessor& b) {
+            return std::make_tuple(a.Sibling, core_ranks[a.Core], a.Node) <
+                   std::make_tuple(b.Sibling, core_ranks[b.Core], b.Node);
+        });
+    }
+
+    std::vector<LogicalProcessor> placed;
+    for (size_t thread = 0; thread < num_threads; thread++)
+    {
+        placed.push_back(order[thread % order.size()]);
+    }
+    return placed;
+}
+
+bool PinCurrentThread(const LogicalProcessor& processor)
+{
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = processor.Group;
+    affinity.Mask = static_cast<KAFFINITY>(1) << processor.Number;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+// Frees the calling thread's scratch buffer when the thread exits
+struct ThreadScratch
+{
+    void* m_buffer = nullptr;
+    size_t m_bytes = 0;
+
+    ~ThreadScratch()
+    {
+        if (m_buffer)
+        {
+            VirtualFree(m_buffer, 0, MEM_RELEASE);
+        }
+    }
+};
+
+void* GetThreadScratch(size_t bytes)
+{
+    static thread_local ThreadScratch scratch;
+    if (bytes > scratch.m_bytes)
+    {
+        if (scratch.m_buffer)
+        {
+            VirtualFree(scratch.m_buffer, 0, MEM_RELEASE);
+            scratch.m_buffer = nullptr;
+            scratch.m_bytes = 0;
+        }
+        PROCESSOR_NUMBER processor;
+        GetCurrentProcessorNumberEx(&processor);
+        USHORT node;
+        DWORD preferred_node = GetNumaProcessorNodeEx(&processor, &node) ? node : NUMA_NO_PREFERRED_NODE;
+        scratch.m_buffer = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT,
+                                              PAGE_READWRITE, preferred_node);
+        if (!scratch.m_buffer)
+        {
+            throw std::bad_alloc();
+        }
+        scratch.m_bytes = bytes;
+    }
+    return scratch.m_buffer;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Where pool workers run. Pinned workers don't migrate between cores, which otherwise dominates run to run variance
+// on machines with several cores and NUMA nodes.
+enum class ThreadPlacement
+{
+    None,  // let the OS schedule workers anywhere
+    Pack,  // fill both SMT siblings of a core, then the next core of the same NUMA node, then the next node
+    Spread // one worker per physical core, alternating between NUMA nodes, before using SMT siblings
+};
+
+struct LogicalProcessor
+{
+    uint16_t Group = 0;   // processor group
+    uint8_t Number = 0;   // within the group
+    unsigned Core = 0;    // physical core, numbered across the machine
+    unsigned Sibling = 0; // SMT sibling within the core
+    unsigned Node = 0;    // NUMA node
+};
+
+// All logical processors of the machine, ordered by NUMA node, core and SMT sibling
+const std::vector<LogicalProcessor>& GetProcessorTopology();
+
+// The logical processor each of num_threads workers should be pinned to. Empty for ThreadPlacement::None. Workers
+// beyond the number of logical processors wrap around.
+std::vector<LogicalProcessor> PlaceThreads(size_t num_threads, ThreadPlacement placement);
+
+// Restricts the calling thread to the logical processor. Returns false if the OS refused.
+bool PinCurrentThread(const LogicalProcessor& processor);
+
+// A buffer of at least bytes that belongs to the calling thread, allocated on the NUMA node the thread runs on when it
+// is first asked for, so pinned workers touch local memory. Valid until the thread exits or asks for more.
+void* GetThreadScratch(size_t bytes);
@@ -1,40 +1,604 @@
 #include "ThreadPool.h"
+#include <algorithm>
 #include <ctime>
 
-ThreadPool::ThreadPool(unsigned int initial_pool_size) : m_threads(), m_destruct_pool(false)
+// Shards shared by the threads that submit work, picked by thread id
+static const size_t SubmitterShardCount = 8;
+
+static double ToMicroseconds(std::chrono::steady_clock::rep ticks)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration(ticks)).count();
+}
+
+static std::chrono::steady_clock::rep Now() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+ThreadPool::ThreadPool(unsigned int initial_pool_size, size_t max_queue_depth, QueueFullPolicy queue_full_policy,
+                       ThreadPlacement placement)
+    : m_threads(), m_destruct_pool(false), m_placement(placement), m_queue_full_policy(queue_full_policy),
+      m_idle_workers(0), m_blocked_producers(0), m_queue_depth(0), m_peak_queue_depth(0), m_rejected_tasks(0),
+      m_dropped_tasks(0), m_min_pool_size(initial_pool_size), m_max_pool_size(initial_pool_size), m_grow_after(0),
+      m_idle_timeout(0), m_created(Clock::now()), m_num_workers(0), m_busy_workers(0), m_front_since(0),
+      m_busy_samples(0), m_worker_samples(0), m_is_collecting_statistics(false), m_num_worker_shards(0),
+      m_worker_time(0)
 {
+    if (max_queue_depth > 0)
+    {
+        m_bounded_queue = std::make_unique<BoundedQueue<QueuedTask>>(max_queue_depth);
+    }
+    m_processors = PlaceThreads(initial_pool_size, placement);
+    std::lock_guard<std::mutex> lock(m_mutex);
     for (unsigned int i = 0; i < initial_pool_size; i++)
     {
-        m_threads.emplace_back([this]() {
-            while (true)
+        StartWorker();
+    }
+}
+
+ThreadPool::~ThreadPool() { Shutdown(); }
+
+void ThreadPool::Shutdown()
+{
+    {
+        // Set under the lock so a worker can't miss the wakeup between checking the predicate and waiting
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_destruct_pool = true;
+    }
+    m_cond_var.notify_all(); // notify destruction to threads
+    m_not_full.notify_all();
+    m_supervisor_cond_var.notify_all();
+    // The supervisor is joined first so that no worker is started while the others are joined
+    if (m_supervisor.joinable())
+    {
+        m_supervisor.join();
+    }
+    for (auto& thread : m_threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AccountWorkerTime();
+    m_num_workers = 0;
+}
+
+void ThreadPool::SetElastic(unsigned int max_pool_size, std::chrono::milliseconds grow_after,
+                            std::chrono::milliseconds idle_timeout)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_pool_size = (std::max)(max_pool_size, m_min_pool_size);
+    m_grow_after = grow_after;
+    m_idle_timeout = idle_timeout;
+    if (IsElastic() && !m_supervisor.joinable())
+    {
+        // Placed again so that the workers added by growing are spread like the initial ones
+        m_processors = PlaceThreads(m_max_pool_size, m_placement);
+        m_front_since = Clock::now().time_since_epoch().count();
+        m_supervisor = std::thread([this]() { SupervisorLoop(); });
+    }
+}
+
+std::vector<ThreadPoolResizeEvent> ThreadPool::ResizeEvents()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_resize_events;
+}
+
+double ThreadPool::Utilization()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_worker_samples > 0 ? static_cast<double>(m_busy_samples) / m_worker_samples : 0;
+}
+
+void ThreadPool::EnableStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_is_collecting_statistics)
+    {
+        return;
+    }
+    // Shards are never added afterwards, so threads that see m_is_collecting_statistics can index them unlocked
+    m_num_worker_shards = (std::max)(static_cast<size_t>(m_max_pool_size), m_threads.size());
+    for (size_t i = 0; i < m_num_worker_shards + SubmitterShardCount; i++)
+    {
+        m_statistics_shards.push_back(std::make_unique<StatisticsShard>());
+    }
+    // Tasks queued before now are counted as submitted now
+    m_submit_times.assign(m_work_queue.size(), Now());
+    m_worker_time = 0;
+    m_worker_time_since = Clock::now();
+    m_is_collecting_statistics = true;
+}
+
+ThreadPoolStatistics ThreadPool::Statistics()
+{
+    ThreadPoolStatistics statistics;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_is_collecting_statistics)
+    {
+        return statistics;
+    }
+    AccountWorkerTime();
+    for (auto& shard : m_statistics_shards)
+    {
+        std::lock_guard<std::mutex> shard_lock(shard->Mutex);
+        statistics.Merge(shard->Statistics);
+    }
+    statistics.WorkerTime = m_worker_time;
+    return statistics;
+}
+
+// Called with m_mutex held before m_num_workers changes
+void ThreadPool::AccountWorkerTime()
+{
+    if (m_is_collecting_statistics)
+    {
+        auto now = Clock::now();
+        m_worker_time += std::chrono::duration<double, std::micro>(now - m_worker_time_since).count() * m_num_workers;
+        m_worker_time_since = now;
+    }
+}
+
+ThreadPool::StatisticsShard& ThreadPool::GetWorkerShard(size_t worker_index)
+{
+    return *m_statistics_shards[worker_index % m_num_worker_shards];
+}
+
+ThreadPool::StatisticsShard& ThreadPool::GetSubmitterShard()
+{
+    size_t hash = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return *m_statistics_shards[m_num_worker_shards + hash % SubmitterShardCount];
+}
+
+// Called with m_mutex held
+void ThreadPool::StartWorker()
+{
+    size_t worker_index = m_threads.size();
+    if (!m_retired_workers.empty())
+    {
+        // The retired worker released the lock before exiting, so this doesn't wait long
+        worker_index = m_retired_workers.back();
+        m_retired_workers.pop_back();
+        m_threads[worker_index].join();
+    }
+    bool pin = !m_processors.empty();
+    LogicalProcessor processor = pin ? m_processors[worker_index % m_processors.size()] : LogicalProcessor();
+    std::thread thread([this, pin, processor, worker_index]() {
+        if (pin)
+        {
+            PinCurrentThread(processor);
+        }
+        if (m_bounded_queue)
+        {
+            BoundedWorkerLoop(worker_index);
+        }
+        else
+        {
+            WorkerLoop(worker_index);
+        }
+    });
+    if (worker_index < m_threads.size())
+    {
+        m_threads[worker_index] = std::move(thread);
+    }
+    else
+    {
+        m_threads.push_back(std::move(thread));
+    }
+    AccountWorkerTime();
+    m_num_workers++;
+}
+
+// Called with m_mutex held after the worker waited m_idle_timeout without a task. Returns true if the worker retires.
+bool ThreadPool::RetireWorker(size_t worker_index)
+{
+    if (m_destruct_pool || m_num_workers <= m_min_pool_size)
+    {
+        return false;
+    }
+    AccountWorkerTime();
+    unsigned int old_size = m_num_workers--;
+    m_retired_workers.push_back(worker_index);
+    m_resize_events.push_back(
+        { std::chrono::duration<double, std::milli>(Clock::now() - m_created).count(), old_size, old_size - 1 });
+    return true;
+}
+
+// submit_time is 0 if the task was queued before statistics were enabled
+void ThreadPool::RunTask(Task& work, size_t worker_index, Clock::rep submit_time)
+{
+    m_busy_workers++;
+    if (!m_is_collecting_statistics)
+    {
+        work();
+        work.Reset();
+    }
+    else
+    {
+        Clock::rep start = Now();
+        work();
+        work.Reset();
+        Clock::rep end = Now();
+        StatisticsShard& shard = GetWorkerShard(worker_index);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        if (submit_time != 0)
+        {
+            shard.Statistics.QueueWait.Record(ToMicroseconds(start - submit_time));
+        }
+        shard.Statistics.RunTime.Record(ToMicroseconds(end - start));
+    }
+    m_busy_workers--;
+}
+
+bool ThreadPool::Enqueue(Task task)
+{
+    bool is_collecting = m_is_collecting_statistics;
+    Clock::rep submit_time = is_collecting ? Now() : 0;
+    if (!m_bounded_queue)
+    {
+        Clock::rep locked = 0;
+        Clock::rep unlocked = 0;
+        size_t queue_length = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (is_collecting)
+            {
+                locked = Now();
+            }
+            if (m_work_queue.empty())
+            {
+                m_front_since = Clock::now().time_since_epoch().count();
+            }
+            m_work_queue.push_back(std::move(task));
+            // Checked again under the lock, which EnableStatistics() holds to line m_submit_times up with the queue
+            if (m_is_collecting_statistics)
+            {
+                m_submit_times.push_back(is_collecting ? locked : Now());
+            }
+            m_queue_depth++;
+            queue_length = m_work_queue.size();
+            if (queue_length > m_peak_queue_depth)
+            {
+                m_peak_queue_depth = queue_length;
+            }
+            if (is_collecting)
+            {
+                unlocked = Now();
+            }
+        }
+
+        m_cond_var.notify_one(); // unblocks one of the waiting threads
+        if (is_collecting)
+        {
+            StatisticsShard& shard = GetSubmitterShard();
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Statistics.LockWait.Record(ToMicroseconds(locked - submit_time));
+            shard.Statistics.LockHold.Record(ToMicroseconds(unlocked - locked));
+            shard.Statistics.QueueLength.Record(static_cast<double>(queue_length));
+        }
+        return true;
+    }
+
+    QueuedTask queued{ std::move(task), submit_time };
+    while (!m_bounded_queue->TryPush(queued))
+    {
+        if (m_queue_full_policy == QueueFullPolicy::Reject)
+        {
+            m_rejected_tasks++;
+            return false;
+        }
+        else if (m_queue_full_policy == QueueFullPolicy::DropOldest)
+        {
+            // The dropped task is destroyed at the end of this scope without running
+            QueuedTask oldest;
+            if (m_bounded_queue->TryPop(oldest))
+            {
+                m_queue_depth--;
+                m_dropped_tasks++;
+            }
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_blocked_producers++;
+            m_not_full.wait(lock, [this] {
+                return m_destruct_pool || m_queue_depth < static_cast<ptrdiff_t>(m_bounded_queue->Capacity());
+            });
+            m_blocked_producers--;
+        }
+    }
+
+    ptrdiff_t new_depth = ++m_queue_depth;
+    if (new_depth == 1 && IsElastic())
+    {
+        m_front_since = Clock::now().time_since_epoch().count();
+    }
+    size_t depth = static_cast<size_t>(std::max<ptrdiff_t>(new_depth, 0));
+    size_t peak = m_peak_queue_depth;
+    while (depth > peak && !m_peak_queue_depth.compare_exchange_weak(peak, depth))
+    {
+    }
+    if (is_collecting)
+    {
+        StatisticsShard& shard = GetSubmitterShard();
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        shard.Statistics.QueueLength.Record(static_cast<double>(depth));
+    }
+    // Workers count themselves idle before checking the queue depth, so either this sees the idle worker or the
+    // worker sees the task. Taking the lock makes sure an idle worker is already waiting when it is notified.
+    if (m_idle_workers > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_cond_var.notify_one();
+    }
+    return true;
+}
+
+void ThreadPool::WorkerLoop(size_t worker_index)
+{
+    while (true)
+    {
+        bool is_collecting = m_is_collecting_statistics;
+        Clock::rep lock_start = is_collecting ? Now() : 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Clock::rep lock_wait = is_collecting ? Now() - lock_start : 0;
+        // thread listening for event and acquire lock if event triggered
+        auto is_ready = [this] { return m_destruct_pool || !m_work_queue.empty(); };
+        if (!IsElastic())
+        {
+            m_cond_var.wait(lock, is_ready);
+        }
+        else if (!m_cond_var.wait_for(lock, m_idle_timeout, is_ready) && RetireWorker(worker_index))
+        {
+            return;
+        }
+        if (!m_work_queue.empty())
+        {
+            // Held from here, the time spent waiting for a task is not contention
+            Clock::rep locked = is_collecting ? Now() : 0;
+            Task work = m_work_queue.pop_front();
+            Clock::rep submit_time = 0;
+            if (m_is_collecting_statistics)
+            {
+                submit_time = m_submit_times.front();
+                m_submit_times.pop_front();
+            }
+            m_queue_depth--;
+            m_front_since = Clock::now().time_since_epoch().count();
+            lock.unlock();
+            if (is_collecting)
+            {
+                Clock::rep unlocked = Now();
+                StatisticsShard& shard = GetWorkerShard(worker_index);
+                std::lock_guard<std::mutex> shard_lock(shard.Mutex);
+                shard.Statistics.LockWait.Record(ToMicroseconds(lock_wait));
+                shard.Statistics.LockHold.Record(ToMicroseconds(unlocked - locked));
+            }
+            RunTask(work, worker_index, submit_time);
+        }
+        else
+        {
+            // Work queue is empty but lock acquired
+            // This means we are destructing the pool
+            break;
+        }
+    }
+}
+
+void ThreadPool::BoundedWorkerLoop(size_t worker_index)
+{
+    QueuedTask queued;
+    while (true)
+    {
+        if (m_bounded_queue->TryPop(queued))
+        {
+            m_queue_depth--;
+            if (IsElastic())
+            {
+                m_front_since = Clock::now().time_since_epoch().count();
+            }
+            if (m_blocked_producers > 0)
             {
-                std::unique_lock<std::mutex> lock(m_mutex);
-                // thread listening for event and acquire lock if event triggered
-                m_cond_var.wait(lock, [this] { return m_destruct_pool || !m_work_queue.empty(); });
-                if (!m_work_queue.empty())
-                {
-                    auto work = m_work_queue.front();
-                    m_work_queue.pop();
-                    lock.unlock();
-                    work();
-                }
-                else
                 {
-                    // Work queue is empty but lock acquired
-                    // This means we are destructing the pool
-                    break;
+                    std::lock_guard<std::mutex> lock(m_mutex);
                 }
+                m_not_full.notify_one();
+            }
+            RunTask(queued.Work, worker_index, queued.SubmitTime);
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_idle_workers++;
+            auto is_ready = [this] { return m_destruct_pool || m_queue_depth > 0; };
+            bool is_retiring = false;
+            if (!IsElastic())
+            {
+                m_cond_var.wait(lock, is_ready);
+            }
+            else if (!m_cond_var.wait_for(lock, m_idle_timeout, is_ready))
+            {
+                is_retiring = RetireWorker(worker_index);
+            }
+            m_idle_workers--;
+            if (is_retiring)
+            {
+                return;
+            }
+            if (m_destruct_pool && m_queue_depth <= 0)
+            {
+                // Queued tasks run before the pool is destructed
+                break;
+            }
+        }
+    }
+}
+
+// Samples how busy the workers are and starts another worker when they all are and the front of the queue stopped
+// moving, checking twice per m_grow_after.
+void ThreadPool::SupervisorLoop()
+{
+    auto interval = (std::max)(m_grow_after / 2, std::chrono::milliseconds(1));
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_supervisor_cond_var.wait_for(lock, interval, [this] { return m_destruct_pool; }))
+    {
+        unsigned int num_workers = m_num_workers;
+        unsigned int busy_workers = m_busy_workers;
+        m_busy_samples += (std::min)(busy_workers, num_workers);
+        m_worker_samples += num_workers;
+
+        auto front_wait = Clock::now() - Clock::time_point(Clock::duration(m_front_since.load()));
+        if (m_queue_depth > 0 && busy_workers >= num_workers && front_wait > m_grow_after &&
+            num_workers < m_max_pool_size)
+        {
+            StartWorker();
+            m_resize_events.push_back({ std::chrono::duration<double, std::milli>(Clock::now() - m_created).count(),
+                                        num_workers, num_workers + 1 });
+            // The new worker resets the wait when it takes the front task
+        }
+    }
+}
+
+// The pool and worker the current thread belongs to, if it is a worker thread of a WorkStealingThreadPool
+static thread_local const void* t_work_stealing_pool = nullptr;
+static thread_local size_t t_work_stealing_worker = 0;
+
+WorkStealingThreadPool::WorkStealingThreadPool(unsigned int initial_pool_size, ThreadPlacement placement)
+    : m_pending(0), m_parked(0), m_next_worker(0), m_destruct_pool(false)
+{
+    initial_pool_size = initial_pool_size == 0 ? 1 : initial_pool_size;
+    for (unsigned int i = 0; i < initial_pool_size; i++)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    std::vector<LogicalProcessor> processors = PlaceThreads(initial_pool_size, placement);
+    for (unsigned int i = 0; i < initial_pool_size; i++)
+    {
+        bool pin = !processors.empty();
+        LogicalProcessor processor = pin ? processors[i] : LogicalProcessor();
+        m_threads.emplace_back([this, pin, processor, i]() {
+            if (pin)
+            {
+                PinCurrentThread(processor);
             }
+            WorkerLoop(i);
         });
     }
 }
 
-ThreadPool::~ThreadPool()
+WorkStealingThreadPool::~WorkStealingThreadPool()
 {
     m_destruct_pool = true;
-    m_cond_var.notify_all(); // notify destruction to threads
+    for (auto& worker : m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->m_mutex);
+        worker->m_wake = true;
+        worker->m_cond_var.notify_one();
+    }
     for (auto& thread : m_threads)
     {
         thread.join();
     }
 }
+
+void WorkStealingThreadPool::Push(Task work)
+{
+    // Work submitted by a task stays on the submitting worker, other threads spread it round robin
+    size_t worker_index = t_work_stealing_pool == this ? t_work_stealing_worker
+                                                       : m_next_worker++ % m_workers.size();
+    {
+        // Counted before it can be taken so that m_pending never drops below the number of queued tasks
+        std::lock_guard<std::mutex> lock(m_workers[worker_index]->m_mutex);
+        m_pending++;
+        m_workers[worker_index]->m_deque.push_back(std::move(work));
+    }
+    if (m_parked > 0)
+    {
+        WakeOne();
+    }
+}
+
+bool WorkStealingThreadPool::TryPop(size_t worker_index, Task& work)
+{
+    Worker& worker = *m_workers[worker_index];
+    std::lock_guard<std::mutex> lock(worker.m_mutex);
+    if (worker.m_deque.empty())
+    {
+        return false;
+    }
+    work = worker.m_deque.pop_back();
+    m_pending--;
+    return true;
+}
+
+bool WorkStealingThreadPool::TrySteal(size_t worker_index, Task& work)
+{
+    for (size_t offset = 1; offset < m_workers.size(); offset++)
+    {
+        Worker& victim = *m_workers[(worker_index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_deque.empty())
+        {
+            work = victim.m_deque.pop_front();
+            m_pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::Park(size_t worker_index)
+{
+    Worker& worker = *m_workers[worker_index];
+    std::unique_lock<std::mutex> lock(worker.m_mutex);
+    worker.m_parked = true;
+    m_parked++;
+    // A task pushed before m_parked was incremented may not have woken anyone, look again before sleeping.
+    if (m_pending == 0 && !m_destruct_pool)
+    {
+        worker.m_cond_var.wait(lock, [&worker] { return worker.m_wake; });
+    }
+    worker.m_wake = false;
+    worker.m_parked = false;
+    m_parked--;
+}
+
+void WorkStealingThreadPool::WakeOne()
+{
+    for (auto& worker : m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->m_mutex);
+        if (worker->m_parked && !worker->m_wake)
+        {
+            worker->m_wake = true;
+            worker->m_cond_var.notify_one();
+            return;
+        }
+    }
+}
+
+void WorkStealingThreadPool::WorkerLoop(size_t worker_index)
+{
+    t_work_stealing_pool = this;
+    t_work_stealing_worker = worker_index;
+    Task work;
+    while (true)
+    {
+        if (TryPop(worker_index, work) || TrySteal(worker_index, work))
+        {
+            work();
+            work.Reset();
+        }
+        else if (m_destruct_pool && m_pending == 0)
+        {
+            // Like ThreadPool, the work queued before destruction is finished first
+            break;
+        }
+        else
+        {
+            Park(worker_index);
+        }
+    }
+}
@@ -2,34 +2,273 @@
 
 #include <vector>
 #include <thread>
-#include <queue>
 #include <mutex>
+#include <condition_variable>
 #include <future>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <tuple>
+#include "BoundedQueue.h"
+#include "Histogram.h"
+#include "Task.h"
+#include "ThreadPlacement.h"
+
+// Wraps f(args...) into a task that fulfills promise with its result or exception. Like std::bind, the arguments are
+// stored by value unless passed with std::ref.
+template <typename R, typename F, typename... Args>
+Task MakePromiseTask(std::promise<R> promise, F&& f, Args&&... args)
+{
+    return Task([promise = std::move(promise), f = std::forward<F>(f),
+                 arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        try
+        {
+            if constexpr (std::is_void<R>::value)
+            {
+                std::apply(f, arguments);
+                promise.set_value();
+            }
+            else
+            {
+                promise.set_value(std::apply(f, arguments));
+            }
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    });
+}
+
+// What ThreadPool does with a task submitted while its queue holds max_queue_depth tasks
+enum class QueueFullPolicy
+{
+    Block,     // wait for a worker to take a task off the queue
+    Reject,    // don't queue the task
+    DropOldest // discard the oldest queued task to make room
+};
+
+// A change in the number of workers of an elastic ThreadPool
+struct ThreadPoolResizeEvent
+{
+    double Time; // in ms since the pool was created
+    unsigned int OldSize;
+    unsigned int NewSize;
+};
+
+// Where the time of a ThreadPool's tasks went, collected after ThreadPool::EnableStatistics(). Times are in
+// microseconds. The pool's mutex is only timed where submitting and taking tasks off the unbounded queue take it.
+struct ThreadPoolStatistics
+{
+    Histogram QueueWait{ 0.001 }; // from submission to start
+    Histogram RunTime{ 0.001 };   // from start to finish
+    Histogram LockWait{ 0.001 };  // acquiring the pool's mutex
+    Histogram LockHold{ 0.001 };  // holding it
+    Histogram QueueLength;        // queued tasks, sampled at every submission
+    double WorkerTime = 0;        // summed over the workers that existed
+
+    void Merge(const ThreadPoolStatistics& other)
+    {
+        QueueWait.Merge(other.QueueWait);
+        RunTime.Merge(other.RunTime);
+        LockWait.Merge(other.LockWait);
+        LockHold.Merge(other.LockHold);
+        QueueLength.Merge(other.QueueLength);
+        WorkerTime += other.WorkerTime;
+    }
+
+    // Fraction of the workers' time spent running tasks
+    double BusyRatio() const { return WorkerTime > 0 ? RunTime.GetTotal() / WorkerTime : 0; }
+};
 
 class ThreadPool
 {
 private:
+    using Clock = std::chrono::steady_clock;
+
+    // A task in the bounded queue, with the time it was submitted when statistics are collected
+    struct QueuedTask
+    {
+        Task Work;
+        Clock::rep SubmitTime = 0;
+    };
+
+    // Threads record statistics in shards so that they don't contend on one lock, see EnableStatistics()
+    struct StatisticsShard
+    {
+        std::mutex Mutex;
+        ThreadPoolStatistics Statistics;
+    };
+
     std::condition_variable m_cond_var;
     bool m_destruct_pool;
     std::mutex m_mutex;
     std::vector<std::thread> m_threads;
-    std::queue<std::function<void()>> m_work_queue;
+    TaskQueue m_work_queue;
+    ThreadPlacement m_placement;
+    std::vector<LogicalProcessor> m_processors;
+
+    // Set when the pool was created with a maximum queue depth, in which case tasks are queued here instead of
+    // m_work_queue and m_mutex is only taken to park idle workers and blocked producers.
+    std::unique_ptr<BoundedQueue<QueuedTask>> m_bounded_queue;
+    QueueFullPolicy m_queue_full_policy;
+    std::condition_variable m_not_full;
+    std::atomic<size_t> m_idle_workers;
+    std::atomic<size_t> m_blocked_producers;
+    // Signed because a worker can take a task off the bounded queue before its producer has counted it
+    std::atomic<ptrdiff_t> m_queue_depth;
+    std::atomic<size_t> m_peak_queue_depth;
+    std::atomic<size_t> m_rejected_tasks;
+    std::atomic<size_t> m_dropped_tasks;
+
+    // Elastic pools grow from m_min_pool_size up to m_max_pool_size workers. Retired workers leave their slot in
+    // m_threads to be joined and reused by the next worker that is started.
+    unsigned int m_min_pool_size;
+    // Atomic because workers check IsElastic() outside the lock after dequeuing
+    std::atomic<unsigned int> m_max_pool_size;
+    std::chrono::milliseconds m_grow_after;
+    std::chrono::milliseconds m_idle_timeout;
+    Clock::time_point m_created;
+    std::atomic<unsigned int> m_num_workers;
+    std::atomic<unsigned int> m_busy_workers;
+    // When the task at the front of the queue got there, in Clock ticks
+    std::atomic<Clock::rep> m_front_since;
+    std::vector<size_t> m_retired_workers;
+    std::vector<ThreadPoolResizeEvent> m_resize_events;
+    // Sums of the busy and running workers sampled by the supervisor
+    uint64_t m_busy_samples;
+    uint64_t m_worker_samples;
+    std::condition_variable m_supervisor_cond_var;
+    std::thread m_supervisor;
+
+    // One shard per worker slot, up to m_num_worker_shards, then shards for the submitting threads
+    std::atomic<bool> m_is_collecting_statistics;
+    std::vector<std::unique_ptr<StatisticsShard>> m_statistics_shards;
+    size_t m_num_worker_shards;
+    // Submission times of the tasks in m_work_queue, in the same order
+    std::deque<Clock::rep> m_submit_times;
+    // Sum of the lifetimes of the workers up to m_worker_time_since, in microseconds
+    double m_worker_time;
+    Clock::time_point m_worker_time_since;
+
+    bool IsElastic() const { return m_max_pool_size > m_min_pool_size; }
+    bool Enqueue(Task task);
+    void StartWorker();
+    bool RetireWorker(size_t worker_index);
+    void RunTask(Task& work, size_t worker_index, Clock::rep submit_time);
+    void AccountWorkerTime();
+    StatisticsShard& GetWorkerShard(size_t worker_index);
+    StatisticsShard& GetSubmitterShard();
+    void WorkerLoop(size_t worker_index);
+    void BoundedWorkerLoop(size_t worker_index);
+    void SupervisorLoop();
 
 public:
-    ThreadPool(unsigned int initial_pool_size);
+    // A max_queue_depth of 0 leaves the queue unbounded. Otherwise submitting to a full queue follows
+    // queue_full_policy. Block deadlocks if all workers submit to their own full pool. Workers pin themselves to the
+    // logical processors chosen by placement before taking their first task.
+    ThreadPool(unsigned int initial_pool_size, size_t max_queue_depth = 0,
+               QueueFullPolicy queue_full_policy = QueueFullPolicy::Block,
+               ThreadPlacement placement = ThreadPlacement::None);
     ~ThreadPool();
+
+    // Runs the queued tasks and joins the workers, after which the counters and statistics stay readable. Don't submit
+    // work afterwards.
+    void Shutdown();
+
+    // Lets the pool grow one worker at a time up to max_pool_size workers while every worker is busy and the task at
+    // the front of the queue has waited longer than grow_after, so that tasks blocked on long operations don't
+    // starve the others. Workers beyond initial_pool_size retire after idle_timeout without a task. Call it before
+    // submitting work.
+    void SetElastic(unsigned int max_pool_size,
+                    std::chrono::milliseconds grow_after = std::chrono::milliseconds(10),
+                    std::chrono::milliseconds idle_timeout = std::chrono::milliseconds(1000));
+
+    // A task that is rejected or dropped is destroyed without running, so its future throws std::future_error with
+    // std::future_errc::broken_promise.
     template <typename F, typename... Args>
     inline auto SubmitWork(F&& f, Args&&... args) -> std::future<decltype(f(args...))>
     {
-        auto func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        auto task = std::make_shared<std::packaged_task<decltype(f(args...))()>>(func);
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            // wrap packed task into a void return function type so that it can be stored in queue
-            m_work_queue.push([task]() { (*task)(); });
-        }
+        // The shared state of the future is the only allocation, the task itself is stored in the queue
+        std::promise<decltype(f(args...))> promise;
+        auto future = promise.get_future();
+        Enqueue(MakePromiseTask(std::move(promise), std::forward<F>(f), std::forward<Args>(args)...));
+        return future;
+    }
+
+    // Queues f without a future to wait on, for work that reports its completion by other means. Small closures are
+    // queued without allocating. Returns false if the queue was full and the policy is Reject.
+    template <typename F>
+    inline bool Post(F&& f)
+    {
+        return Enqueue(Task(std::forward<F>(f)));
+    }
+
+    size_t QueueDepth() const { return m_queue_depth > 0 ? static_cast<size_t>(m_queue_depth) : 0; }
+    size_t PeakQueueDepth() const { return m_peak_queue_depth; }
+    // Tasks not queued under QueueFullPolicy::Reject and tasks discarded under QueueFullPolicy::DropOldest
+    size_t RejectedTasks() const { return m_rejected_tasks; }
+    size_t DroppedTasks() const { return m_dropped_tasks; }
+
+    unsigned int PoolSize() const { return m_num_workers; }
+    std::vector<ThreadPoolResizeEvent> ResizeEvents();
+    // Fraction of the workers that were running a task, sampled while the pool is elastic
+    double Utilization();
 
-        m_cond_var.notify_one(); // unblocks one of the waiting threads
-        return task->get_future();
+    // Starts collecting ThreadPoolStatistics, at the cost of a few clock reads and an uncontended lock per task. Call
+    // it after SetElastic(), so that every worker gets its own shard.
+    void EnableStatistics();
+    // The statistics of all threads since EnableStatistics()
+    ThreadPoolStatistics Statistics();
+};
+
+// A thread pool with one task deque per worker. Workers pop their own deque LIFO, so tasks submitted from a worker
+// run while their data is still warm, and steal FIFO from the other workers when their deque is empty. Tasks
+// submitted from other threads are spread round robin over the workers. Every deque has its own lock and idle
+// workers park on their own condition variable, so submitting and popping never contend on a pool wide lock.
+class WorkStealingThreadPool
+{
+private:
+    struct Worker
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_cond_var;
+        TaskQueue m_deque;
+        bool m_parked = false;
+        bool m_wake = false;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    // Tasks submitted but not yet taken by a worker, and workers parked waiting for one
+    std::atomic<size_t> m_pending;
+    std::atomic<size_t> m_parked;
+    std::atomic<size_t> m_next_worker;
+    std::atomic<bool> m_destruct_pool;
+
+    void Push(Task work);
+    bool TryPop(size_t worker_index, Task& work);
+    bool TrySteal(size_t worker_index, Task& work);
+    void Park(size_t worker_index);
+    void WakeOne();
+    void WorkerLoop(size_t worker_index);
+
+public:
+    WorkStealingThreadPool(unsigned int initial_pool_size, ThreadPlacement placement = ThreadPlacement::None);
+    ~WorkStealingThreadPool();
+    template <typename F, typename... Args>
+    inline auto SubmitWork(F&& f, Args&&... args) -> std::future<decltype(f(args...))>
+    {
+        std::promise<decltype(f(args...))> promise;
+        auto future = promise.get_future();
+        Push(MakePromiseTask(std::move(promise), std::forward<F>(f), std::forward<Args>(args)...));
+        return future;
+    }
+
+    template <typename F>
+    inline void Post(F&& f)
+    {
+        Push(Task(std::forward<F>(f)));
     }
 };
@@ -1,13 +1,32 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#ifdef _WIN32
 #ifndef DISABLE_GPU_COUNTERS
 #include <Pdh.h>
 #include <PdhMsg.h>
 #endif
 #include <psapi.h>
+#else
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+// GPU counters are read through PDH, which only exists on Windows
+#ifndef DISABLE_GPU_COUNTERS
+#define DISABLE_GPU_COUNTERS
+#endif
+#endif
+#include "Histogram.h"
+#include "RunningStatistics.h"
 
-#define TIMER_SLOT_SIZE (1024)
 #define CONVERT_100NS_TO_SECOND(x) ((x)*0.0000001)
 #define BYTE_TO_MB(x) ((x) / (1024.0 * 1024.0))
 
@@ -16,25 +35,126 @@
 class Timer
 {
 public:
-    void Start()
+    void Start() { m_startTime = GetTicks(); }
+
+    double Stop() { return (GetTicks() - m_startTime) * GetMillisecondsPerTick(); }
+
+private:
+#ifdef _WIN32
+    // QueryPerformanceCounter reads the invariant TSC on processors that have one. Its frequency is fixed at boot, so
+    // it is only queried once.
+    static int64_t GetTicks()
     {
-        LARGE_INTEGER t;
-        QueryPerformanceCounter(&t);
-        m_startTime = static_cast<double>(t.QuadPart);
+        LARGE_INTEGER ticks;
+        QueryPerformanceCounter(&ticks);
+        return ticks.QuadPart;
     }
 
-    double Stop()
+    static double GetMillisecondsPerTick()
     {
-        LARGE_INTEGER stopTime;
-        QueryPerformanceCounter(&stopTime);
-        double t = static_cast<double>(stopTime.QuadPart) - m_startTime;
-        LARGE_INTEGER tps;
-        QueryPerformanceFrequency(&tps);
-        return t / static_cast<double>(tps.QuadPart) * 1000;
+        static const double millisecondsPerTick = [] {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return 1000.0 / static_cast<double>(frequency.QuadPart);
+        }();
+        return millisecondsPerTick;
+    }
+#else
+    // steady_clock is the vDSO clock_gettime(CLOCK_MONOTONIC), which reads the TSC without a system call
+    static int64_t GetTicks() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+    static double GetMillisecondsPerTick()
+    {
+        using Period = std::chrono::steady_clock::period;
+        return 1000.0 * Period::num / Period::den;
+    }
+#endif
+
+    int64_t m_startTime = 0;
+};
+
+// The counters of the current process that CpuPerfCounter compares between Start and Stop
+struct ProcessCounters
+{
+    double ProcessTime = 0; // kernel and user time of all threads, in second
+    uint64_t PageFaultCount = 0;
+    uint64_t PagefileUsage = 0;      // in byte
+    uint64_t PeakPagefileUsage = 0;  // in byte
+    uint64_t WorkingSetSize = 0;     // in byte
+    uint64_t PeakWorkingSetSize = 0; // in byte
+};
+
+// Reads ProcessCounters with as few system calls as the platform allows
+class ProcessCounterReader
+{
+public:
+#ifdef _WIN32
+    // The pseudo handle of the current process has every access right, so no handle is opened and closed per read
+    bool Read(ProcessCounters& counters)
+    {
+        FILETIME ftIgnore, ftKernel, ftUser;
+        PROCESS_MEMORY_COUNTERS pmc = { 0 };
+        if (!GetProcessTimes(GetCurrentProcess(), &ftIgnore, &ftIgnore, &ftKernel, &ftUser) ||
+            !GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        {
+            return false;
+        }
+
+        ULARGE_INTEGER kernelTime, userTime;
+        kernelTime.LowPart = ftKernel.dwLowDateTime;
+        kernelTime.HighPart = ftKernel.dwHighDateTime;
+        userTime.LowPart = ftUser.dwLowDateTime;
+        userTime.HighPart = ftUser.dwHighDateTime;
+        counters.ProcessTime = CONVERT_100NS_TO_SECOND(static_cast<double>(kernelTime.QuadPart + userTime.QuadPart));
+        counters.PageFaultCount = pmc.PageFaultCount;
+        counters.PagefileUsage = pmc.PagefileUsage;
+        counters.PeakPagefileUsage = pmc.PeakPagefileUsage;
+        counters.WorkingSetSize = pmc.WorkingSetSize;
+        counters.PeakWorkingSetSize = pmc.PeakWorkingSetSize;
+        return true;
+    }
+#else
+    // Times and page faults come from getrusage, memory from /proc/self/statm. Its data field, the private memory the
+    // process committed, stands in for the pagefile usage, whose peak is the highest this reader has seen.
+    bool Read(ProcessCounters& counters)
+    {
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return false;
+
+        char buffer[128];
+        int statm = GetStatmDescriptor();
+        ssize_t length = statm < 0 ? -1 : pread(statm, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0)
+            return false;
+
+        buffer[length] = '\0';
+        unsigned long long pages, resident, shared, text, library, data;
+        if (sscanf(buffer, "%llu %llu %llu %llu %llu %llu", &pages, &resident, &shared, &text, &library, &data) != 6)
+            return false;
+
+        static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        counters.ProcessTime = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                               (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 0.000001;
+        counters.PageFaultCount = usage.ru_minflt + usage.ru_majflt;
+        counters.PagefileUsage = data * pageSize;
+        m_peakPagefileUsage = (std::max)(m_peakPagefileUsage, counters.PagefileUsage);
+        counters.PeakPagefileUsage = m_peakPagefileUsage;
+        counters.WorkingSetSize = resident * pageSize;
+        counters.PeakWorkingSetSize = static_cast<uint64_t>(usage.ru_maxrss) * 1024; // ru_maxrss is in kilobyte
+        return true;
     }
 
 private:
-    double m_startTime;
+    // Opened once for the whole process and read with pread, which doesn't move a shared file offset
+    static int GetStatmDescriptor()
+    {
+        static const int statm = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+        return statm;
+    }
+
+    uint64_t m_peakPagefileUsage = 0;
+#endif
 };
 
 class CpuPerfCounter
@@ -46,23 +166,10 @@ public:
 
     void Reset()
     {
-        SYSTEM_INFO sysInfo = { 0 };
-        GetSystemInfo(&sysInfo);
-
-        m_startKernelTime = { 0 };
-        m_startUserTime = { 0 };
-        m_numProcessors = sysInfo.dwNumberOfProcessors;
-        m_procHandle = GetCurrentProcess();
-        ;
-        m_pid = GetCurrentProcessId();
-        ;
+        m_numProcessors = std::thread::hardware_concurrency();
         m_previousStartCallFailed = true;
         m_processTime = 0;
-        m_startPageFaultCount = 0;
-        m_startPagefileUsage = 0;
-        m_startPeakPagefileUsage = 0;
-        m_startWorkingSetSize = 0;
-        m_startPeakWorkingSetSize = 0;
+        m_start = ProcessCounters();
         m_deltaPageFaultCount = 0;
         m_deltaPagefileUsage = 0;
         m_deltaPeakPagefileUsage = 0;
@@ -70,104 +177,40 @@ public:
         m_deltaPeakWorkingSetSize = 0;
     }
 
-    void Start()
-    {
-        FILETIME ftIgnore, ftKernel, ftUser;
-
-        if (!GetProcessTimes(m_procHandle, &ftIgnore, &ftIgnore, &ftKernel, &ftUser) ||
-            !GetProcessMemoryCounters(m_pid, m_startPageFaultCount, m_startPagefileUsage, m_startPeakPagefileUsage,
-                                      m_startWorkingSetSize, m_startPeakWorkingSetSize))
-        {
-            m_previousStartCallFailed = true;
-        }
-        else
-        {
-            memcpy(&m_startKernelTime, &ftKernel, sizeof(FILETIME));
-            memcpy(&m_startUserTime, &ftUser, sizeof(FILETIME));
-            m_previousStartCallFailed = false;
-        }
-    }
+    void Start() { m_previousStartCallFailed = !m_reader.Read(m_start); }
 
     void Stop()
     {
-        FILETIME ftIgnore, ftKernel, ftUser;
-        ULARGE_INTEGER stopKernelTime, stopUserTime;
-        ULONG stopPageFaultCount = 0;
-        SIZE_T stopPagefileUsage = 0;
-        SIZE_T stopPeakPagefileUsage = 0;
-        SIZE_T stopWorkingSetSize = 0;
-        SIZE_T stopPeakWorkingSetSize = 0;
-
-        if (m_previousStartCallFailed || m_numProcessors == 0 ||
-            !GetProcessTimes(m_procHandle, &ftIgnore, &ftIgnore, &ftKernel, &ftUser) ||
-            !GetProcessMemoryCounters(m_pid, stopPageFaultCount, stopPagefileUsage, stopPeakPagefileUsage,
-                                      stopWorkingSetSize, stopPeakWorkingSetSize))
+        ProcessCounters stop;
+        if (m_previousStartCallFailed || m_numProcessors == 0 || !m_reader.Read(stop))
         {
             return;
         }
 
-        memcpy(&stopKernelTime, &ftKernel, sizeof(FILETIME));
-        memcpy(&stopUserTime, &ftUser, sizeof(FILETIME));
-        m_processTime = CONVERT_100NS_TO_SECOND((stopKernelTime.QuadPart - m_startKernelTime.QuadPart) +
-                                                (stopUserTime.QuadPart - m_startUserTime.QuadPart)) /
-                        m_numProcessors;
-
-        m_deltaPageFaultCount = stopPageFaultCount - m_startPageFaultCount;
-        m_deltaPagefileUsage = (double)BYTE_TO_MB((double)stopPagefileUsage - (double)m_startPagefileUsage);
-        m_deltaPeakPagefileUsage = (double)BYTE_TO_MB((double)stopPeakPagefileUsage - (double)m_startPeakPagefileUsage);
-        m_deltaWorkingSetSize = (double)BYTE_TO_MB((double)stopWorkingSetSize - (double)m_startWorkingSetSize);
+        m_processTime = (stop.ProcessTime - m_start.ProcessTime) / m_numProcessors;
+        m_deltaPageFaultCount = stop.PageFaultCount - m_start.PageFaultCount;
+        m_deltaPagefileUsage = BYTE_TO_MB((double)stop.PagefileUsage - (double)m_start.PagefileUsage);
+        m_deltaPeakPagefileUsage = BYTE_TO_MB((double)stop.PeakPagefileUsage - (double)m_start.PeakPagefileUsage);
+        m_deltaWorkingSetSize = BYTE_TO_MB((double)stop.WorkingSetSize - (double)m_start.WorkingSetSize);
         m_deltaPeakWorkingSetSize =
-            (double)BYTE_TO_MB((double)stopPeakWorkingSetSize - (double)m_startPeakWorkingSetSize);
+            BYTE_TO_MB((double)stop.PeakWorkingSetSize - (double)m_start.PeakWorkingSetSize);
     }
 
     double GetProcessTime() { return m_processTime; }
-    ULONG GetDeltaPageFaultCount() { return m_deltaPageFaultCount; }
+    uint64_t GetDeltaPageFaultCount() { return m_deltaPageFaultCount; }
     double GetDeltaPageFileUsage() { return m_deltaPagefileUsage; }
     double GetDeltaPeakPageFileUsage() { return m_deltaPeakPagefileUsage; }
     double GetDeltaWorkingSetUsage() { return m_deltaWorkingSetSize; }
     double GetDeltaPeakWorkingSetUsage() { return m_deltaPeakWorkingSetSize; }
-    double GetStartWorkingSet() { return (double)BYTE_TO_MB((double)m_startWorkingSetSize); }
+    double GetStartWorkingSet() { return BYTE_TO_MB((double)m_start.WorkingSetSize); }
 
 private:
-    bool GetProcessMemoryCounters(DWORD pid, ULONG& pageFaultCount, SIZE_T& pageFileUsage, SIZE_T& peakPageFileUsage,
-                                  SIZE_T& workingSetSize, SIZE_T& peakWorkingSetSize)
-    {
-        HANDLE hProcess = NULL;
-
-        hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-        if (NULL == hProcess)
-            return false;
-
-        PROCESS_MEMORY_COUNTERS pmc = { 0 };
-
-        bool result = GetProcessMemoryInfo(hProcess, &pmc, sizeof(pmc));
-        if (result)
-        {
-            pageFaultCount = pmc.PageFaultCount;
-            pageFileUsage = pmc.PagefileUsage;
-            peakPageFileUsage = pmc.PeakPagefileUsage;
-            workingSetSize = pmc.WorkingSetSize;
-            peakWorkingSetSize = pmc.PeakWorkingSetSize;
-        }
-
-        CloseHandle(hProcess);
-
-        return result;
-    }
-
-    ULARGE_INTEGER m_startKernelTime;
-    ULARGE_INTEGER m_startUserTime;
-    UINT m_numProcessors;
-    HANDLE m_procHandle;
-    DWORD m_pid;
+    ProcessCounterReader m_reader;
+    unsigned int m_numProcessors;
     bool m_previousStartCallFailed;
+    ProcessCounters m_start;
     double m_processTime; // in second
-    ULONG m_startPageFaultCount;
-    SIZE_T m_startPagefileUsage;      // in byte
-    SIZE_T m_startPeakPagefileUsage;  // in byte
-    SIZE_T m_startWorkingSetSize;     // in byte
-    SIZE_T m_startPeakWorkingSetSize; // in byte
-    ULONG m_deltaPageFaultCount;
+    uint64_t m_deltaPageFaultCount;
     double m_deltaPagefileUsage;      // in MByte
     double m_deltaPeakPagefileUsage;  // in MByte
     double m_deltaWorkingSetSize;     // in MByte
@@ -436,12 +479,23 @@ const static std::vector<std::wstring> CounterTypeName = { L"TIMER",
                                                            L"STARTING_WORKING_SET",
                                                            L"STARTING_SHARED_MEM" };
 
+// What profiling an interval costs, see PerfCounterStatistics::Calibrate()
+struct ProfilingOverhead
+{
+    double Interval = 0; // in ms, measured by an empty interval and subtracted from every time
+    double Call = 0;     // in ms, spent in a Start and Stop pair
+};
+
 class PerfCounterStatistics
 {
 public:
+    // Resolution in ms of the times kept in histograms
+    static constexpr double TimeResolution = 0.001;
+
     PerfCounterStatistics()
     {
         m_bDisabled = false;
+        m_isTimingOnly = false;
         Reset();
         m_bDisabled = true;
     }
@@ -450,20 +504,53 @@ public:
 
     void Disable() { m_bDisabled = true; }
 
+    // Only reads the clock, so that the CPU, memory and GPU counters don't cost more than short intervals take. Those
+    // counters then stay 0.
+    void SetTimingOnly(bool isTimingOnly) { m_isTimingOnly = isTimingOnly; }
+    bool IsTimingOnly() const { return m_isTimingOnly; }
+
+    // Measures the median of samples empty intervals, which is subtracted from the times measured afterwards. Call it
+    // after SetTimingOnly(), since reading every counter costs more than reading the clock.
+    ProfilingOverhead Calibrate(int samples = 200)
+    {
+        if (m_bDisabled)
+            return m_overhead;
+
+        m_overhead = ProfilingOverhead();
+        Histogram intervals{ 0.00001 };
+        Histogram calls{ 0.00001 };
+        Timer callTimer;
+        double counterValue[CounterType::TYPE_COUNT] = {};
+        for (int i = 0; i < samples; ++i)
+        {
+            callTimer.Start();
+            Start();
+            Collect(counterValue);
+            calls.Record(callTimer.Stop());
+            intervals.Record(counterValue[CounterType::TIMER]);
+        }
+        m_overhead.Interval = intervals.GetPercentile(50);
+        m_overhead.Call = calls.GetPercentile(50);
+        return m_overhead;
+    }
+
+    const ProfilingOverhead& GetOverhead() const { return m_overhead; }
+    void SetOverhead(const ProfilingOverhead& overhead) { m_overhead = overhead; }
+
     void Reset()
     {
         if (m_bDisabled)
             return;
 
-        m_pos = 0;
-        m_bBufferFull = false;
+        m_timeHistogram.Reset();
         m_cpuCounter.Reset();
 #ifndef DISABLE_GPU_COUNTERS
         m_gpuCounter.Reset();
 #endif
         for (int i = 0; i < CounterType::TYPE_COUNT; ++i)
         {
-            m_data[i].Reset();
+            m_moments[i].Reset();
+            m_medians[i].Reset();
         }
     }
 
@@ -472,11 +559,15 @@ public:
         if (m_bDisabled)
             return;
 
-        m_timer.Start();
-        m_cpuCounter.Start();
+        // The clock is started last and stopped first, so that reading the other counters isn't timed
+        if (!m_isTimingOnly)
+        {
+            m_cpuCounter.Start();
 #ifndef DISABLE_GPU_COUNTERS
-        m_gpuCounter.Start();
+            m_gpuCounter.Start();
 #endif
+        }
+        m_timer.Start();
     }
 
     void Stop()
@@ -484,18 +575,104 @@ public:
         if (m_bDisabled)
             return;
 
-        double counterValue[CounterType::TYPE_COUNT];
+        double counterValue[CounterType::TYPE_COUNT] = {};
+        Collect(counterValue);
+        Record(counterValue);
+    }
+
+    // Records a time in ms that was measured without Start() and Stop(), e.g. by a completion handler or a worker
+    // thread. The other counters are 0 for that sample.
+    void RecordTime(double time)
+    {
+        if (m_bDisabled)
+            return;
+
+        double counterValue[CounterType::TYPE_COUNT] = {};
+        counterValue[CounterType::TIMER] = time;
+        Record(counterValue);
+    }
+
+    // Adds the samples of another set of statistics, e.g. to fold measurements that were taken on another thread
+    // into this one. The last sample of other becomes the last sample.
+    void Merge(const PerfCounterStatistics& other)
+    {
+        if (m_bDisabled || other.m_bDisabled || other.GetCount() == 0)
+            return;
+
+        for (int i = 0; i < CounterType::TYPE_COUNT; ++i)
+        {
+            m_moments[i].Merge(other.m_moments[i]);
+            m_medians[i].Merge(other.m_medians[i]);
+        }
+        m_timeHistogram.Merge(other.m_timeHistogram);
+
+        clockTime = other.clockTime;
+        CpuWorkingDiff = other.CpuWorkingDiff;
+        CpuWorkingStart = other.CpuWorkingStart;
+        GpuSharedDiff = other.GpuSharedDiff;
+        GpuSharedStart = other.GpuSharedStart;
+        GpuDedicatedDiff = other.GpuDedicatedDiff;
+    }
+
+    int GetCount() const { return static_cast<int>(m_moments[CounterType::TIMER].GetCount()); }
+    double GetAverage(CounterType t) const { return (m_bDisabled) ? 0 : m_moments[t].GetAverage(); }
+    double GetMin(CounterType t) const { return (m_bDisabled) ? 0 : m_moments[t].GetMin(); }
+    double GetMax(CounterType t) const { return (m_bDisabled) ? 0 : m_moments[t].GetMax(); }
+    double GetStdev(CounterType t) const { return (m_bDisabled) ? 0 : m_moments[t].GetStdev(); }
+    double GetVariance(CounterType t) const { return (m_bDisabled) ? 0 : m_moments[t].GetVariance(); }
+    // Estimated with P-square, except for TIMER which has a histogram
+    double GetMedian(CounterType t) const
+    {
+        if (m_bDisabled)
+            return 0;
+
+        return t == CounterType::TIMER ? m_timeHistogram.GetPercentile(50) : m_medians[t].Get();
+    }
+
+    // Nearest-rank percentile of the TIMER counter in ms, percentile is in [0, 100]. Within 1% or 1 us of the exact
+    // value, the maximum is exact.
+    double GetTimePercentile(double percentile) const
+    {
+        return (m_bDisabled) ? 0 : m_timeHistogram.GetPercentile(percentile);
+    }
+    // Robust statistics of the TIMER counter in ms for noisy runs, see Histogram
+    double GetTimeTrimmedMean(double fraction) const
+    {
+        return (m_bDisabled) ? 0 : m_timeHistogram.GetTrimmedMean(fraction);
+    }
+    double GetTimeMedianAbsoluteDeviation() const
+    {
+        return (m_bDisabled) ? 0 : m_timeHistogram.GetMedianAbsoluteDeviation();
+    }
+    std::pair<double, double> GetTimeConfidenceInterval(double confidence) const
+    {
+        return (m_bDisabled) ? std::pair<double, double>(0, 0)
+                             : m_timeHistogram.GetAverageConfidenceInterval(confidence);
+    }
+    double GetClockTime() { return clockTime; }
+    double GetCpuWorkingDiff() { return CpuWorkingDiff; }
+    double GetGpuSharedDiff() { return GpuSharedDiff; }
+    double GetCpuWorkingStart() { return CpuWorkingStart; }
+    double GetGpuSharedStart() { return GpuSharedStart; }
+    double GetGpuDedicatedDiff() { return GpuDedicatedDiff; }
+
+private:
+    // Stops the clock and reads the deltas of the counters since Start()
+    void Collect(double (&counterValue)[CounterType::TYPE_COUNT])
+    {
+        double time = (std::max)(m_timer.Stop() - m_overhead.Interval, 0.0);
+        counterValue[CounterType::TIMER] = time;
+        if (m_isTimingOnly)
+        {
+            std::fill(counterValue + CounterType::CPU_USAGE, counterValue + CounterType::TYPE_COUNT, 0.0);
+            return;
+        }
 
-        // Query counters
-        double time = m_timer.Stop();
         m_cpuCounter.Stop();
 #ifndef DISABLE_GPU_COUNTERS
         m_gpuCounter.Stop();
 #endif
-
-        // Get counter values
-        counterValue[CounterType::TIMER] = time;
-        counterValue[CounterType::CPU_USAGE] = 100000.0 * m_cpuCounter.GetProcessTime() / time;
+        counterValue[CounterType::CPU_USAGE] = time > 0 ? 100000.0 * m_cpuCounter.GetProcessTime() / time : 0;
         counterValue[CounterType::PAGE_FAULT_COUNT] = m_cpuCounter.GetDeltaPageFaultCount();
         counterValue[CounterType::PAGE_FILE_USAGE] = m_cpuCounter.GetDeltaPageFileUsage();
         counterValue[CounterType::PEAK_PAGE_FILE_USAGE] = m_cpuCounter.GetDeltaPeakPageFileUsage();
@@ -508,25 +685,16 @@ public:
         counterValue[CounterType::GPU_SHARED_MEM_USAGE] = m_gpuCounter.GetSharedMemory();
         counterValue[CounterType::STARTING_SHARED_MEM] = m_gpuCounter.GetStartSharedMemory();
 #endif
-        // Update data blocks
-        for (int i = 0; i < CounterType::TYPE_COUNT; ++i)
-        {
-            m_data[i].total = m_data[i].total - m_data[i].measured[m_pos] + counterValue[i];
-            m_data[i].measured[m_pos] = counterValue[i];
-            m_data[i].max = (counterValue[i] > m_data[i].max) ? counterValue[i] : m_data[i].max;
-            m_data[i].min = (counterValue[i] < m_data[i].min) ? counterValue[i] : m_data[i].min;
-        }
+    }
 
-        // Update buffer index
-        if (m_pos + 1 >= TIMER_SLOT_SIZE)
-        {
-            m_pos = 0;
-            m_bBufferFull = true;
-        }
-        else
+    void Record(const double (&counterValue)[CounterType::TYPE_COUNT])
+    {
+        for (int i = 0; i < CounterType::TYPE_COUNT; ++i)
         {
-            ++m_pos;
+            m_moments[i].Record(counterValue[i]);
+            m_medians[i].Record(counterValue[i]);
         }
+        m_timeHistogram.Record(counterValue[CounterType::TIMER]);
 
         clockTime = counterValue[CounterType::TIMER];
         CpuWorkingDiff = counterValue[CounterType::WORKING_SET_USAGE];
@@ -536,60 +704,19 @@ public:
         GpuDedicatedDiff = counterValue[CounterType::GPU_DEDICATED_MEM_USAGE];
     }
 
-    int GetCount() const { return (m_bBufferFull) ? TIMER_SLOT_SIZE : m_pos; }
-    double GetAverage(CounterType t) const { return (m_bDisabled) ? 0 : m_data[t].total / GetCount(); }
-    double GetMin(CounterType t) const { return (m_bDisabled) ? 0 : m_data[t].min; }
-    double GetMax(CounterType t) const { return (m_bDisabled) ? 0 : m_data[t].max; }
-    double GetValues(CounterType t, int index) const { return (m_bDisabled) ? 0 : m_data[t].measured[index]; }
-    double GetStdev(CounterType t) const { return (m_bDisabled) ? 0 : sqrt(GetVariance(t)); }
-    double GetVariance(CounterType t) const
-    {
-        if (m_bDisabled)
-            return 0;
-
-        int count = GetCount();
-        double average = m_data[t].total / count;
-        double var = 0;
-        for (int i = 0; i < count; ++i)
-        {
-            var += (m_data[t].measured[i] - average) * (m_data[t].measured[i] - average);
-        }
-        return var / count;
-    }
-    double GetClockTime() { return clockTime; }
-    double GetCpuWorkingDiff() { return CpuWorkingDiff; }
-    double GetGpuSharedDiff() { return GpuSharedDiff; }
-    double GetCpuWorkingStart() { return CpuWorkingStart; }
-    double GetGpuSharedStart() { return GpuSharedStart; }
-    double GetGpuDedicatedDiff() { return GpuDedicatedDiff; }
-
-private:
-    struct DataBlock
-    {
-        void Reset()
-        {
-            max = 0;
-            min = DBL_MAX;
-            total = 0;
-            memset(measured, 0, sizeof(double) * TIMER_SLOT_SIZE);
-        }
-
-        double max;
-        double min;
-        double total;
-        double measured[TIMER_SLOT_SIZE];
-    };
-
-    int m_pos;
-    bool m_bBufferFull;
     bool m_bDisabled;
+    bool m_isTimingOnly;
+    ProfilingOverhead m_overhead;
+    // Counters other than TIMER can be negative, so only times are kept in a histogram
+    Histogram m_timeHistogram{ TimeResolution };
 
     Timer m_timer;
     CpuPerfCounter m_cpuCounter;
 #ifndef DISABLE_GPU_COUNTERS
     GpuPerfCounter m_gpuCounter;
 #endif
-    DataBlock m_data[CounterType::TYPE_COUNT];
+    RunningMoments m_moments[CounterType::TYPE_COUNT];
+    P2Quantile m_medians[CounterType::TYPE_COUNT];
 
     double clockTime;
     double CpuWorkingDiff;
@@ -599,6 +726,171 @@ private:
     double GpuDedicatedDiff;
 };
 
+// Statistics of latency samples (in milliseconds) that were collected outside of a PerfCounterStatistics, e.g. by
+// concurrent workers that each time their own calls. The samples are counted in a Histogram at the resolution of the
+// profiler, so memory doesn't grow with the number of samples and percentiles agree with the perf results.
+class LatencySummary
+{
+public:
+    void Record(double latency) { m_histogram.Record(latency); }
+    void Merge(const LatencySummary& other) { m_histogram.Merge(other.m_histogram); }
+
+    size_t GetCount() const { return static_cast<size_t>(m_histogram.GetCount()); }
+    double GetTotal() const { return m_histogram.GetTotal(); }
+    double GetAverage() const { return m_histogram.GetAverage(); }
+    double GetMin() const { return m_histogram.GetMin(); }
+    double GetMax() const { return m_histogram.GetMax(); }
+    double GetStdev() const { return m_histogram.GetStdev(); }
+    // Nearest-rank percentile, percentile is in [0, 100]
+    double GetPercentile(double percentile) const { return m_histogram.GetPercentile(percentile); }
+
+private:
+    Histogram m_histogram{ PerfCounterStatistics::TimeResolution };
+};
+
+// Decides how many iterations to run from the evaluate times observed so far. Warm-up lasts until the coefficient of
+// variation over a sliding window of samples drops below warmupCV. Measurement then lasts until the 95% confidence
+// interval of the mean or median of the steady state samples is narrower than targetRelativeError of its value.
+class SteadyStateDetector
+{
+public:
+    enum class Phase
+    {
+        WarmUp,
+        Measure,
+        Done
+    };
+    enum class Statistic
+    {
+        Mean,
+        Median
+    };
+
+    SteadyStateDetector(double warmupCV, double targetRelativeError, Statistic statistic,
+                        size_t maxIterations, size_t windowSize = 10)
+        : m_warmupCV(warmupCV), m_targetRelativeError(targetRelativeError), m_statistic(statistic),
+          m_maxIterations(maxIterations), m_windowSize(windowSize)
+    {
+    }
+
+    Phase AddSample(double sample)
+    {
+        if (m_phase == Phase::WarmUp)
+        {
+            m_window.push_back(sample);
+            if (m_window.size() > m_windowSize)
+            {
+                m_window.erase(m_window.begin());
+            }
+            m_warmupIterations++;
+            // Give up on warming up once half of the iteration budget is spent, so that something is still measured
+            // on models that never settle.
+            bool isStable = m_window.size() == m_windowSize && GetWindowCV() <= m_warmupCV;
+            if (isStable || m_warmupIterations >= m_maxIterations / 2)
+            {
+                m_isWarmupConverged = isStable;
+                m_phase = Phase::Measure;
+            }
+        }
+        else if (m_phase == Phase::Measure)
+        {
+            m_moments.Record(sample);
+            if (m_statistic == Statistic::Median)
+            {
+                m_sorted.insert(std::upper_bound(m_sorted.begin(), m_sorted.end(), sample), sample);
+            }
+            size_t count = GetMeasuredIterations();
+            if ((count >= m_windowSize && GetRelativeError() <= m_targetRelativeError) ||
+                m_warmupIterations + count >= m_maxIterations)
+            {
+                m_isMeasurementConverged = GetRelativeError() <= m_targetRelativeError;
+                m_phase = Phase::Done;
+            }
+        }
+        return m_phase;
+    }
+
+    Phase GetPhase() const { return m_phase; }
+    size_t GetWarmupIterations() const { return m_warmupIterations; }
+    size_t GetMeasuredIterations() const { return static_cast<size_t>(m_moments.GetCount()); }
+    bool IsWarmupConverged() const { return m_isWarmupConverged; }
+    bool IsMeasurementConverged() const { return m_isMeasurementConverged; }
+    Statistic GetStatistic() const { return m_statistic; }
+
+    double GetWindowCV() const
+    {
+        if (m_window.empty())
+            return 0;
+
+        double average = std::accumulate(m_window.begin(), m_window.end(), 0.0) / m_window.size();
+        double var = 0;
+        for (double sample : m_window)
+        {
+            var += (sample - average) * (sample - average);
+        }
+        return average > 0 ? sqrt(var / m_window.size()) / average : 0;
+    }
+
+    double GetEstimate() const
+    {
+        return m_statistic == Statistic::Mean ? m_moments.GetAverage() : GetPercentile(50);
+    }
+
+    // Half-width of the 95% confidence interval of the estimate, relative to the estimate. Checked after every
+    // sample, so it reads the running moments or the samples kept in order instead of sorting them again.
+    double GetRelativeError() const
+    {
+        size_t count = GetMeasuredIterations();
+        if (count < 2)
+            return DBL_MAX;
+
+        double halfWidth;
+        double estimate;
+        if (m_statistic == Statistic::Mean)
+        {
+            estimate = m_moments.GetAverage();
+            halfWidth = 1.96 * m_moments.GetStdev() / sqrt(static_cast<double>(count - 1));
+        }
+        else
+        {
+            // Distribution-free interval from order statistics, using the normal approximation of the binomial.
+            estimate = GetPercentile(50);
+            double rankSpread = 1.96 * sqrt(static_cast<double>(count)) / 2;
+            double lowerPercentile = (std::max)(0.0, (count / 2.0 - rankSpread) / count) * 100;
+            double upperPercentile = (std::min)(1.0, (count / 2.0 + rankSpread + 1) / count) * 100;
+            halfWidth = (GetPercentile(upperPercentile) - GetPercentile(lowerPercentile)) / 2;
+        }
+        return estimate > 0 ? halfWidth / estimate : DBL_MAX;
+    }
+
+private:
+    // Nearest-rank percentile of the steady state samples, percentile is in [0, 100]
+    double GetPercentile(double percentile) const
+    {
+        if (m_sorted.empty())
+            return 0;
+
+        size_t rank = static_cast<size_t>(ceil(percentile / 100.0 * m_sorted.size()));
+        return m_sorted[rank == 0 ? 0 : (std::min)(rank, m_sorted.size()) - 1];
+    }
+
+    double m_warmupCV;
+    double m_targetRelativeError;
+    Statistic m_statistic;
+    size_t m_maxIterations;
+    size_t m_windowSize;
+
+    Phase m_phase = Phase::WarmUp;
+    size_t m_warmupIterations = 0;
+    bool m_isWarmupConverged = false;
+    bool m_isMeasurementConverged = false;
+    std::vector<double> m_window;
+    // Evaluate times in ms after the warm up. Medians need the exact order statistics, since a histogram bucket is
+    // wider than tight targets.
+    RunningMoments m_moments;
+    std::vector<double> m_sorted;
+};
+
 // A class to wrap up multiple PerfCounterStatistics objects.
 // To create a profiler, define intervals in an enum and use it to create the profiler object.
 template <typename T> class Profiler
@@ -636,6 +928,27 @@ public:
         }
     }
 
+    void SetTimingOnly(bool isTimingOnly)
+    {
+        for (int i = 0; i < T::COUNT; ++i)
+        {
+            m_perfCounterStat[i].SetTimingOnly(isTimingOnly);
+        }
+    }
+
+    // Calibrates one interval and subtracts its overhead from all of them, see PerfCounterStatistics::Calibrate()
+    ProfilingOverhead Calibrate()
+    {
+        ProfilingOverhead overhead = m_perfCounterStat[0].Calibrate();
+        for (int i = 1; i < T::COUNT; ++i)
+        {
+            m_perfCounterStat[i].SetOverhead(overhead);
+        }
+        return overhead;
+    }
+
+    const ProfilingOverhead& GetOverhead() const { return m_perfCounterStat[0].GetOverhead(); }
+
 private:
     PerfCounterStatistics m_perfCounterStat[T::COUNT];
 };
@@ -38,6 +38,16 @@ enum class DeviceCreationLocation
     WinML,
     UserD3DDevice
 };
+enum class ArrivalProcess
+{
+    Constant,
+    Poisson
+};
+enum class AdaptiveStatistic
+{
+    Mean,
+    Median
+};
 
 class TypeHelper
 {
@@ -3,11 +3,19 @@
 #include "Common.h"
 #include <iostream>
 #include <codecvt>
+#include <winrt/Windows.Foundation.Metadata.h>
 using namespace std;
+using namespace winrt::Windows::Foundation::Metadata;
 
 void PopulateSessionOptions(LearningModelSessionOptions& sessionOptions)
 {
-    // Batch Size Override as 1
+    // Batch Size Override as 1, on versions of Windows that support it
+    if (!ApiInformation::IsPropertyPresent(L"Windows.AI.MachineLearning.LearningModelSessionOptions",
+                                           L"BatchSizeOverride"))
+    {
+        printf("Batch size override isn't supported on this version of Windows.\n");
+        return;
+    }
     try
     {
         sessionOptions.BatchSizeOverride(1);